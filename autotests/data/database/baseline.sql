@@ -0,0 +1,27 @@
+-- SPDX-FileCopyrightText: none
+-- SPDX-License-Identifier: GPL-3.0-only
+-- schema of the releases before the migrations (user_version 0 or 1), one statement per line
+CREATE TABLE Fetcher (id INTEGER UNIQUE);
+INSERT INTO Fetcher VALUES (1);
+CREATE TABLE "Groups" (id TEXT UNIQUE, name TEXT, url TEXT);
+CREATE TABLE Channels (id TEXT UNIQUE, name TEXT, url TEXT, image TEXT);
+CREATE TABLE GroupChannels (id TEXT UNIQUE, "Group" TEXT, channel TEXT);
+CREATE TABLE Programs (id TEXT UNIQUE, url TEXT, channel TEXT, start INTEGER, stop INTEGER, title TEXT, subtitle TEXT, description TEXT, descriptionFetched INTEGER);
+CREATE TABLE ProgramCategories (program TEXT, category TEXT);
+CREATE TABLE Favorites (id INTEGER UNIQUE, channel TEXT UNIQUE);
+INSERT INTO "Groups" VALUES ('xmltv', 'XMLTV', '/tmp/guide.xml');
+INSERT INTO Channels VALUES ('C1', 'Channel 1', '', '');
+INSERT INTO Channels VALUES ('C2', 'Channel 2', '', '');
+INSERT INTO GroupChannels VALUES ('xmltv_C1', 'xmltv', 'C1');
+INSERT INTO GroupChannels VALUES ('xmltv_C2', 'xmltv', 'C2');
+INSERT INTO Favorites VALUES (0, 'C1');
+INSERT INTO Programs VALUES ('C1_1668038400', 'https://example.com/1', 'C1', 1668038400, 1668040200, 'News', 'Morning', 'First program', 1);
+INSERT INTO Programs VALUES ('C1_1668040200', '', 'C1', 1668040200, 1668042000, 'Weather', '', '', 0);
+INSERT INTO Programs VALUES ('C2_1668038400', '', 'C2', 1668038400, 1668045600, 'Movie', '', '', 0);
+INSERT INTO Programs VALUES (NULL, '', 'C2', 1668045600, 1668049200, 'Broken', '', '', 0);
+INSERT INTO ProgramCategories VALUES ('C1_1668038400', 'News');
+INSERT INTO ProgramCategories VALUES ('C1_1668038400', 'News');
+INSERT INTO ProgramCategories VALUES ('C1_1668038400', 'Info');
+INSERT INTO ProgramCategories VALUES ('C1_1668040200', 'News');
+INSERT INTO ProgramCategories VALUES ('C2_1668038400', 'Movie');
+INSERT INTO ProgramCategories VALUES ('C9_1668038400', 'Orphan');
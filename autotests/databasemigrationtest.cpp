@@ -0,0 +1,144 @@
+// SPDX-FileCopyrightText: none
+// SPDX-License-Identifier: GPL-3.0-only
+
+#include "TellySkoutSettings.h"
+#include "categories.h"
+#include "database.h"
+
+#include <QDir>
+#include <QFile>
+#include <QSqlDatabase>
+#include <QSqlQuery>
+#include <QStandardPaths>
+#include <QTest>
+
+#include <algorithm>
+
+// user_version of the baseline database (0: created before the migrations, 1: createTables())
+#ifndef BASELINE_VERSION
+#define BASELINE_VERSION 1
+#endif
+
+class DatabaseMigrationTest : public QObject
+{
+    Q_OBJECT
+
+private Q_SLOTS:
+    void initTestCase();
+    void version();
+    void channels();
+    void programs();
+    void categories();
+
+private:
+    static int count(const QString &table);
+};
+
+void DatabaseMigrationTest::initTestCase()
+{
+    // fresh settings and database (in ~/.qttest)
+    QStandardPaths::setTestModeEnabled(true);
+    QFile::remove(QStandardPaths::writableLocation(QStandardPaths::GenericConfigLocation) + QStringLiteral("/tellyskoutrc"));
+    const QString databasePath = QStandardPaths::writableLocation(QStandardPaths::AppDataLocation);
+    QDir(databasePath).removeRecursively();
+    QDir(databasePath).mkpath(databasePath);
+
+    TellySkoutSettings settings;
+    settings.setFetcher(TellySkoutSettings::EnumFetcher::XMLTV);
+    settings.save();
+
+    // the database of an old release (before Database::instance() migrates it)
+    QFile fixture(QFINDTESTDATA("data/database/baseline.sql"));
+    QVERIFY(fixture.open(QIODevice::ReadOnly | QIODevice::Text));
+    {
+        QSqlDatabase baseline = QSqlDatabase::addDatabase(QStringLiteral("QSQLITE"), QStringLiteral("baseline"));
+        baseline.setDatabaseName(databasePath + QStringLiteral("/database.db3"));
+        QVERIFY(baseline.open());
+        QSqlQuery query(baseline);
+        while (!fixture.atEnd()) {
+            const QString statement = QString::fromUtf8(fixture.readLine()).trimmed();
+            if (statement.isEmpty() || statement.startsWith(QLatin1String("--"))) {
+                continue;
+            }
+            QVERIFY2(query.exec(statement), qPrintable(statement));
+        }
+        QVERIFY(query.exec(QStringLiteral("PRAGMA user_version = ") + QString::number(BASELINE_VERSION) + QStringLiteral(";")));
+        baseline.close();
+    }
+    QSqlDatabase::removeDatabase(QStringLiteral("baseline"));
+
+    Database::instance(); // migrates to the current version
+}
+
+void DatabaseMigrationTest::version()
+{
+    QSqlQuery query(QSqlDatabase::database());
+    QVERIFY(query.exec(QStringLiteral("PRAGMA user_version;")));
+    QVERIFY(query.next());
+    QCOMPARE(query.value(0).toInt(), 4);
+
+    // added by the migrations
+    QCOMPARE(Database::instance().importFingerprint(ChannelId(QStringLiteral("C1"))), QString());
+    QCOMPARE(count(QStringLiteral("FetchedDays")), 0);
+}
+
+void DatabaseMigrationTest::channels()
+{
+    QCOMPARE(Database::instance().groupCount(), size_t(1));
+    QCOMPARE(Database::instance().channelCount(), size_t(2));
+    QCOMPARE(Database::instance().channel(ChannelId(QStringLiteral("C2"))).m_name, QStringLiteral("Channel 2"));
+    QCOMPARE(Database::instance().favorites(), QVector<ChannelId>{ChannelId(QStringLiteral("C1"))});
+}
+
+void DatabaseMigrationTest::programs()
+{
+    // the program without ID is dropped
+    QCOMPARE(count(QStringLiteral("Programs")), 3);
+
+    const QVector<ProgramData> programs = Database::instance().programs(ChannelId(QStringLiteral("C1")));
+    QCOMPARE(programs.size(), 2);
+
+    const ProgramData &program = programs.front();
+    QCOMPARE(program.m_id.value(), QStringLiteral("C1_1668038400"));
+    QCOMPARE(program.m_url, QStringLiteral("https://example.com/1"));
+    QCOMPARE(program.m_channelId.value(), QStringLiteral("C1"));
+    QCOMPARE(program.m_startTime.toSecsSinceEpoch(), qint64(1668038400));
+    QCOMPARE(program.m_stopTime.toSecsSinceEpoch(), qint64(1668040200));
+    QCOMPARE(program.m_title, QStringLiteral("News"));
+    QCOMPARE(program.m_subtitle, QStringLiteral("Morning"));
+    QCOMPARE(program.m_description, QStringLiteral("First program"));
+    QCOMPARE(program.m_descriptionFetched, true);
+
+    QCOMPARE(programs.back().m_title, QStringLiteral("Weather"));
+    QCOMPARE(programs.back().m_descriptionFetched, false);
+}
+
+void DatabaseMigrationTest::categories()
+{
+    // the categories of unknown programs and duplicates are dropped, the most frequent category gets the first ID
+    QCOMPARE(count(QStringLiteral("Categories")), 3);
+    QCOMPARE(Categories::instance().id(QStringLiteral("News")), CategoryId(0));
+
+    const QVector<ProgramData> programs = Database::instance().programs(ChannelId(QStringLiteral("C1")));
+    QCOMPARE(programs.size(), 2);
+    QVector<QString> names = Categories::instance().names(programs.front().m_categories);
+    std::sort(names.begin(), names.end());
+    QCOMPARE(names, (QVector<QString>{QStringLiteral("Info"), QStringLiteral("News")}));
+    QCOMPARE(Categories::instance().names(programs.back().m_categories), QVector<QString>{QStringLiteral("News")});
+
+    // all IDs fit into the mask of the program
+    QCOMPARE(count(QStringLiteral("ProgramCategories")), 0);
+}
+
+int DatabaseMigrationTest::count(const QString &table)
+{
+    QSqlQuery query(QSqlDatabase::database());
+    if (!query.exec(QStringLiteral("SELECT COUNT() FROM ") + table + QStringLiteral(";")) || !query.next()) {
+        return -1;
+    }
+    return query.value(0).toInt();
+}
+
+QTEST_GUILESS_MAIN(DatabaseMigrationTest)
+
+#include "databasemigrationtest.moc"
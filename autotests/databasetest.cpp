@@ -0,0 +1,161 @@
+// SPDX-FileCopyrightText: none
+// SPDX-License-Identifier: GPL-3.0-only
+
+#include "TellySkoutSettings.h"
+#include "categories.h"
+#include "database.h"
+
+#include <QDateTime>
+#include <QDir>
+#include <QFile>
+#include <QSqlDatabase>
+#include <QSqlQuery>
+#include <QStandardPaths>
+#include <QTest>
+
+namespace
+{
+// 3 weeks of 30 min programs for 1000 channels (1M programs)
+const int channelCount = 1000;
+const int visibleChannelCount = 50; // rows of the channel table
+const int programsPerChannel = 1000;
+const qint64 programLength = 1800;
+const qint64 first = QDateTime(QDate(2022, 11, 10), QTime(0, 0), Qt::UTC).toSecsSinceEpoch();
+
+ChannelId channelId(int index)
+{
+    return ChannelId(QStringLiteral("C%1").arg(index, 4, 10, QLatin1Char('0')));
+}
+}
+
+class DatabaseTest : public QObject
+{
+    Q_OBJECT
+
+private Q_SLOTS:
+    void initTestCase();
+    void programsInWindow_data();
+    void programsInWindow();
+    void benchmarkProgramsInWindow_data();
+    void benchmarkProgramsInWindow();
+    void fetchedDays();
+
+private:
+    static void setIndex(bool enabled);
+};
+
+void DatabaseTest::initTestCase()
+{
+    // fresh settings and database (in ~/.qttest)
+    QStandardPaths::setTestModeEnabled(true);
+    QFile::remove(QStandardPaths::writableLocation(QStandardPaths::GenericConfigLocation) + QStringLiteral("/tellyskoutrc"));
+    QDir(QStandardPaths::writableLocation(QStandardPaths::AppDataLocation)).removeRecursively();
+
+    TellySkoutSettings settings;
+    settings.setFetcher(TellySkoutSettings::EnumFetcher::XMLTV);
+    settings.save();
+
+    Database::instance(); // creates the tables and loads the (no) categories
+
+    QVector<CategoryId> categories;
+    for (int i = 0; i < 5; ++i) {
+        categories.push_back(Categories::instance().id(QStringLiteral("Category %1").arg(i)));
+    }
+
+    for (int channel = 0; channel < channelCount; ++channel) {
+        QVector<ProgramData> programs;
+        programs.reserve(programsPerChannel);
+        for (int i = 0; i < programsPerChannel; ++i) {
+            const qint64 start = first + i * programLength;
+            ProgramData data;
+            data.m_channelId = channelId(channel);
+            data.m_id = ProgramId(data.m_channelId.value() + "_" + QString::number(start));
+            data.m_startTime = QDateTime::fromSecsSinceEpoch(start, Qt::UTC);
+            data.m_stopTime = QDateTime::fromSecsSinceEpoch(start + programLength, Qt::UTC);
+            data.m_title = QStringLiteral("Program %1").arg(i);
+            data.m_descriptionFetched = false;
+            data.m_categories.insert(categories.at(i % categories.size()));
+            programs.push_back(data);
+        }
+        Database::instance().updatePrograms(programs);
+    }
+    Database::instance().takeProgramChanges();
+}
+
+void DatabaseTest::programsInWindow_data()
+{
+    QTest::addColumn<bool>("index");
+
+    QTest::newRow("with index") << true;
+    QTest::newRow("without index") << false;
+}
+
+void DatabaseTest::programsInWindow()
+{
+    QFETCH(bool, index);
+
+    setIndex(index);
+
+    // second day: the program which starts at its end is included
+    const QVector<ProgramData> programs = Database::instance().programs(channelId(7), first + 86400, first + 2 * 86400);
+    setIndex(true);
+
+    QCOMPARE(programs.size(), 49);
+    QCOMPARE(programs.front().m_startTime.toSecsSinceEpoch(), first + 86400);
+    QCOMPARE(programs.back().m_startTime.toSecsSinceEpoch(), first + 2 * 86400);
+    QCOMPARE(programs.front().m_channelId.value(), channelId(7).value());
+    QCOMPARE(programs.front().m_categories.ids().size(), 1);
+}
+
+void DatabaseTest::benchmarkProgramsInWindow_data()
+{
+    QTest::addColumn<bool>("index");
+
+    QTest::newRow("with index") << true;
+    QTest::newRow("without index") << false;
+}
+
+void DatabaseTest::benchmarkProgramsInWindow()
+{
+    QFETCH(bool, index);
+
+    // the visible day of the visible channels (as in the channel table)
+    setIndex(index);
+    int programCount = 0;
+    QBENCHMARK {
+        programCount = 0;
+        for (int channel = 0; channel < visibleChannelCount; ++channel) {
+            programCount += Database::instance().programs(channelId(channel), first + 86400, first + 2 * 86400).size();
+        }
+    }
+    setIndex(true);
+
+    QCOMPARE(programCount, visibleChannelCount * 49);
+}
+
+void DatabaseTest::fetchedDays()
+{
+    // only the requested channel and days
+    const QDate day(2022, 11, 11);
+    Database::instance().addFetchedDay(channelId(7), day);
+    Database::instance().addFetchedDay(channelId(7), day.addDays(2));
+    Database::instance().addFetchedDay(channelId(7), day.addDays(5));
+    Database::instance().addFetchedDay(channelId(8), day.addDays(1));
+
+    QCOMPARE(Database::instance().fetchedDays(channelId(7), day, day.addDays(2)), (QVector<QDate>{day, day.addDays(2)}));
+    QVERIFY(Database::instance().fetchedDays(channelId(9), day, day.addDays(5)).isEmpty());
+}
+
+void DatabaseTest::setIndex(bool enabled)
+{
+    QSqlQuery query(QSqlDatabase::database());
+    if (enabled) {
+        QVERIFY(query.exec(QStringLiteral("CREATE INDEX IF NOT EXISTS ProgramsByChannel ON Programs (channel, start, stop);")));
+    } else {
+        QVERIFY(query.exec(QStringLiteral("DROP INDEX IF EXISTS ProgramsByChannel;")));
+    }
+}
+
+QTEST_GUILESS_MAIN(DatabaseTest)
+
+#include "databasetest.moc"
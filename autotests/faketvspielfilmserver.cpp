@@ -0,0 +1,146 @@
+// SPDX-FileCopyrightText: none
+// SPDX-License-Identifier: GPL-3.0-only
+
+#include "faketvspielfilmserver.h"
+
+#include <QDate>
+#include <QHostAddress>
+#include <QList>
+#include <QTcpSocket>
+#include <QTimer>
+#include <QUrl>
+#include <QUrlQuery>
+
+namespace
+{
+// day of the recorded pages as shown in the program table (e.g. "Do 10.11.")
+const QByteArray recordedDate("10.11.");
+
+const QByteArray paginationBegin("<ul class=\"pagination__items\">");
+const QByteArray paginationEnd("</ul>");
+}
+
+FakeTvSpielfilmServer::FakeTvSpielfilmServer(const QByteArray &firstPage, const QByteArray &nextPage)
+    : m_firstPage(firstPage)
+    , m_nextPage(nextPage)
+{
+    connect(&m_server, &QTcpServer::newConnection, this, [this]() {
+        while (QTcpSocket *socket = m_server.nextPendingConnection()) {
+            connect(socket, &QTcpSocket::readyRead, this, [this, socket]() {
+                readRequest(socket);
+            });
+            connect(socket, &QTcpSocket::disconnected, this, [this, socket]() {
+                m_requests.remove(socket);
+                socket->deleteLater();
+            });
+        }
+    });
+}
+
+bool FakeTvSpielfilmServer::listen()
+{
+    return m_server.listen(QHostAddress::LocalHost);
+}
+
+QString FakeTvSpielfilmServer::url() const
+{
+    return QStringLiteral("http://127.0.0.1:") + QString::number(m_server.serverPort());
+}
+
+void FakeTvSpielfilmServer::setDelay(int delay)
+{
+    m_delay = delay;
+}
+
+void FakeTvSpielfilmServer::setPageCount(int count)
+{
+    m_pageCount = count;
+}
+
+void FakeTvSpielfilmServer::setFailingChannels(const QSet<QString> &channelIds)
+{
+    m_failingChannels = channelIds;
+}
+
+int FakeTvSpielfilmServer::requestCount() const
+{
+    return m_requestCount;
+}
+
+void FakeTvSpielfilmServer::readRequest(QTcpSocket *socket)
+{
+    // GET requests only, i.e. the request ends with the header
+    QByteArray &request = m_requests[socket];
+    request += socket->readAll();
+    if (!request.contains("\r\n\r\n")) {
+        return;
+    }
+
+    // GET /tv-programm/sendungen/?time=day&channel=ARD&date=2022-11-10&page=1 HTTP/1.1
+    const QByteArray target = request.left(request.indexOf("\r\n")).split(' ').value(1);
+    m_requests.remove(socket);
+    ++m_requestCount;
+
+    QTimer::singleShot(m_delay, socket, [this, socket, target]() {
+        respond(socket, target);
+    });
+}
+
+void FakeTvSpielfilmServer::respond(QTcpSocket *socket, const QByteArray &target)
+{
+    const QUrl url(QString::fromLatin1(target));
+    const QUrlQuery query(url);
+    const QString channelId = query.queryItemValue(QStringLiteral("channel"));
+    const QDate date = QDate::fromString(query.queryItemValue(QStringLiteral("date")), Qt::ISODate);
+    const int page = query.queryItemValue(QStringLiteral("page")).toInt();
+
+    QByteArray status("200 OK");
+    QByteArray body;
+    if (url.path() != QLatin1String("/tv-programm/sendungen/") || !date.isValid() || page < 1 || page > m_pageCount) {
+        status = "404 Not Found";
+    } else if (m_failingChannels.contains(channelId)) {
+        status = "500 Internal Server Error";
+    } else {
+        body = programPage(channelId, date, page);
+    }
+
+    // nothing is cached (every refresh fetches all pages)
+    socket->write("HTTP/1.1 " + status + "\r\nContent-Type: text/html; charset=utf-8\r\nContent-Length: " + QByteArray::number(body.size())
+                  + "\r\nCache-Control: no-store\r\nConnection: close\r\n\r\n" + body);
+    socket->disconnectFromHost();
+}
+
+QByteArray FakeTvSpielfilmServer::programPage(const QString &channelId, const QDate &date, int page) const
+{
+    QByteArray html = page == 1 ? m_firstPage : m_nextPage;
+
+    // the recorded pagination is replaced by one for the configured page count
+    const int begin = html.indexOf(paginationBegin);
+    const int end = begin >= 0 ? html.indexOf(paginationEnd, begin) : -1;
+    if (end >= 0) {
+        html.replace(begin, end + paginationEnd.size() - begin, pagination(channelId, date, page));
+    }
+
+    // the recorded programs are moved to the requested day
+    html.replace(recordedDate, date.toString(QStringLiteral("dd.MM.")).toLatin1());
+
+    return html;
+}
+
+QByteArray FakeTvSpielfilmServer::pagination(const QString &channelId, const QDate &date, int page) const
+{
+    const QByteArray pageUrl = (url() + "/tv-programm/sendungen/?time=day&amp;channel=" + channelId + "&amp;date=" + date.toString(Qt::ISODate) + "&amp;page=").toUtf8();
+
+    QByteArray html = paginationBegin + "\n";
+    for (int i = 1; i <= m_pageCount; ++i) {
+        const QByteArray current = i == page ? " pagination__link--current" : "";
+        html += "<li class=\"pagination__item\"><a class=\"pagination__link" + current + "\" href=\"" + pageUrl + QByteArray::number(i) + "\">"
+            + QByteArray::number(i) + "</a></li>\n";
+    }
+    if (page < m_pageCount) {
+        html += "<li class=\"pagination__item\"><a class=\"pagination__link pagination__link--next\" href=\"" + pageUrl + QByteArray::number(page + 1)
+            + "\" rel=\"next\">Weiter</a></li>\n";
+    }
+    html += paginationEnd;
+    return html;
+}
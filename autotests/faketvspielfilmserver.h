@@ -0,0 +1,47 @@
+// SPDX-FileCopyrightText: none
+// SPDX-License-Identifier: GPL-3.0-only
+
+#pragma once
+
+#include <QObject>
+
+#include <QByteArray>
+#include <QHash>
+#include <QSet>
+#include <QString>
+#include <QTcpServer>
+
+class QDate;
+class QTcpSocket;
+
+// serves recorded TV Spielfilm program pages on localhost (for any channel and day)
+// the first recorded page is served as page 1, the second one as all further pages
+class FakeTvSpielfilmServer : public QObject
+{
+    Q_OBJECT
+public:
+    FakeTvSpielfilmServer(const QByteArray &firstPage, const QByteArray &nextPage);
+
+    bool listen(); // on a free port
+    QString url() const; // base URL, see TellySkoutSettings::tvSpielfilmUrl
+
+    void setDelay(int delay); // ms before each response
+    void setPageCount(int count); // pages per day (pagination)
+    void setFailingChannels(const QSet<QString> &channelIds); // HTTP 500 for their pages
+    int requestCount() const;
+
+private:
+    void readRequest(QTcpSocket *socket);
+    void respond(QTcpSocket *socket, const QByteArray &target);
+    QByteArray programPage(const QString &channelId, const QDate &date, int page) const;
+    QByteArray pagination(const QString &channelId, const QDate &date, int page) const;
+
+    QTcpServer m_server;
+    QByteArray m_firstPage;
+    QByteArray m_nextPage;
+    QHash<QTcpSocket *, QByteArray> m_requests; // received part of the request header
+    int m_delay = 0;
+    int m_pageCount = 2;
+    QSet<QString> m_failingChannels;
+    int m_requestCount = 0;
+};
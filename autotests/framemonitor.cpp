@@ -0,0 +1,39 @@
+// SPDX-FileCopyrightText: none
+// SPDX-License-Identifier: GPL-3.0-only
+
+#include "framemonitor.h"
+
+#include <QDebug>
+
+namespace
+{
+const int frameInterval = 16; // ms (60 Hz)
+}
+
+FrameMonitor::FrameMonitor(const QString &name)
+    : m_name(name)
+{
+    m_timer.setInterval(frameInterval);
+    m_timer.setTimerType(Qt::PreciseTimer);
+    connect(&m_timer, &QTimer::timeout, this, &FrameMonitor::checkFrame);
+
+    m_frameClock.start();
+    m_clock.start();
+    m_timer.start();
+}
+
+FrameMonitor::~FrameMonitor()
+{
+    checkFrame();
+    const qint64 duration = qMax<qint64>(1, m_clock.elapsed());
+    qInfo().nospace() << m_name << ": blocked the GUI thread for " << m_droppedFrames << " frames in " << duration << " ms ("
+                      << m_droppedFrames * 1000.0 / duration << " dropped frames/s)";
+}
+
+void FrameMonitor::checkFrame()
+{
+    const qint64 elapsed = m_frameClock.restart();
+    if (elapsed > 2 * frameInterval) {
+        m_droppedFrames += static_cast<int>(elapsed / frameInterval) - 1;
+    }
+}
@@ -0,0 +1,29 @@
+// SPDX-FileCopyrightText: none
+// SPDX-License-Identifier: GPL-3.0-only
+
+#pragma once
+
+#include <QObject>
+
+#include <QElapsedTimer>
+#include <QString>
+#include <QTimer>
+
+// measures how much background work blocks the GUI thread: a 60 Hz timer which ticks late has dropped frames
+// runs while the test waits for the work (fetching, parsing, importing and the database writes) to be finished
+class FrameMonitor : public QObject
+{
+    Q_OBJECT
+public:
+    explicit FrameMonitor(const QString &name);
+    ~FrameMonitor(); // logs the result
+
+private:
+    void checkFrame();
+
+    QString m_name;
+    QTimer m_timer;
+    QElapsedTimer m_frameClock; // since the previous tick
+    QElapsedTimer m_clock; // since the start
+    int m_droppedFrames = 0;
+};
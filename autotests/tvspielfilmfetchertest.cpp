@@ -0,0 +1,212 @@
+// SPDX-FileCopyrightText: none
+// SPDX-License-Identifier: GPL-3.0-only
+
+#include "TellySkoutSettings.h"
+#include "database.h"
+#include "faketvspielfilmserver.h"
+#include "framemonitor.h"
+#include "tvspielfilmfetcher.h"
+
+#include <QDir>
+#include <QFile>
+#include <QSignalSpy>
+#include <QSqlDatabase>
+#include <QSqlQuery>
+#include <QStandardPaths>
+#include <QTest>
+
+#include <memory>
+
+// signal arguments recorded by QSignalSpy
+Q_DECLARE_METATYPE(ChannelId)
+Q_DECLARE_METATYPE(Error)
+
+namespace
+{
+// rows of the recorded pages (programs per day with two pages)
+const int programsPerDay = 10;
+
+QByteArray readFile(const QString &fileName)
+{
+    QFile file(fileName);
+    if (!file.open(QIODevice::ReadOnly)) {
+        return QByteArray();
+    }
+    return file.readAll();
+}
+
+QVector<ChannelId> channelIds(int count)
+{
+    QVector<ChannelId> ids;
+    for (int i = 0; i < count; ++i) {
+        ids.push_back(ChannelId(QStringLiteral("C%1").arg(i, 3, 10, QLatin1Char('0'))));
+    }
+    return ids;
+}
+}
+
+class TvSpielfilmFetcherTest : public QObject
+{
+    Q_OBJECT
+
+private Q_SLOTS:
+    void initTestCase();
+    void init();
+    void refresh_data();
+    void refresh();
+    void refreshWithError();
+    void skipFetchedDays();
+    void benchmarkRefresh_data();
+    void benchmarkRefresh();
+
+private:
+    void clearPrograms();
+
+    std::unique_ptr<FakeTvSpielfilmServer> m_server;
+};
+
+void TvSpielfilmFetcherTest::initTestCase()
+{
+    qRegisterMetaType<ChannelId>();
+    qRegisterMetaType<Error>();
+
+    m_server.reset(new FakeTvSpielfilmServer(readFile(QFINDTESTDATA("data/tvspielfilm/programs-page1.html")),
+                                             readFile(QFINDTESTDATA("data/tvspielfilm/programs-page2.html"))));
+    QVERIFY(m_server->listen());
+
+    // fresh settings, database and cache (in ~/.qttest)
+    QStandardPaths::setTestModeEnabled(true);
+    QFile::remove(QStandardPaths::writableLocation(QStandardPaths::GenericConfigLocation) + QStringLiteral("/tellyskoutrc"));
+    QDir(QStandardPaths::writableLocation(QStandardPaths::AppDataLocation)).removeRecursively();
+    QDir(QStandardPaths::writableLocation(QStandardPaths::CacheLocation)).removeRecursively();
+
+    // yesterday + today
+    TellySkoutSettings settings;
+    settings.setFetcher(TellySkoutSettings::EnumFetcher::TVSpielfilm);
+    settings.setTvSpielfilmUrl(m_server->url());
+    settings.setTvSpielfilmDays(1);
+    settings.save();
+
+    Database::instance(); // creates the tables
+}
+
+void TvSpielfilmFetcherTest::init()
+{
+    m_server->setDelay(0);
+    m_server->setPageCount(2);
+    m_server->setFailingChannels(QSet<QString>());
+    clearPrograms();
+}
+
+void TvSpielfilmFetcherTest::refresh_data()
+{
+    QTest::addColumn<int>("pageCount");
+    QTest::addColumn<int>("delay");
+
+    QTest::newRow("one page") << 1 << 0;
+    QTest::newRow("two pages") << 2 << 0;
+    QTest::newRow("five pages") << 5 << 0;
+    QTest::newRow("slow server") << 2 << 200;
+}
+
+void TvSpielfilmFetcherTest::refresh()
+{
+    QFETCH(int, pageCount);
+    QFETCH(int, delay);
+
+    m_server->setPageCount(pageCount);
+    m_server->setDelay(delay);
+    const int requestCount = m_server->requestCount();
+
+    const QVector<ChannelId> ids = channelIds(3);
+    TvSpielfilmFetcher fetcher;
+    QSignalSpy updated(&fetcher, &FetcherImpl::channelUpdated);
+    QSignalSpy failed(&fetcher, &FetcherImpl::errorFetchingChannel);
+    fetcher.fetchPrograms(ids, FetchPriority::Normal);
+
+    // once per channel and day
+    QTRY_COMPARE_WITH_TIMEOUT(updated.count(), 2 * ids.size(), 30000);
+    QCOMPARE(failed.count(), 0);
+    QCOMPARE(m_server->requestCount() - requestCount, 2 * ids.size() * pageCount);
+
+    // page 1 has the morning programs, all further pages the same afternoon and evening programs
+    const int programCount = pageCount == 1 ? 6 : programsPerDay;
+    for (const auto &id : ids) {
+        QCOMPARE(Database::instance().programCount(id), static_cast<size_t>(2 * programCount));
+    }
+}
+
+void TvSpielfilmFetcherTest::refreshWithError()
+{
+    const QVector<ChannelId> ids = channelIds(3);
+    m_server->setFailingChannels(QSet<QString>{ids.at(1).value()});
+
+    TvSpielfilmFetcher fetcher;
+    QSignalSpy updated(&fetcher, &FetcherImpl::channelUpdated);
+    QSignalSpy failed(&fetcher, &FetcherImpl::errorFetchingChannel);
+    fetcher.fetchPrograms(ids, FetchPriority::Normal);
+
+    // the other channels are stored nevertheless
+    QTRY_COMPARE_WITH_TIMEOUT(updated.count(), 2 * (ids.size() - 1), 30000);
+    QTRY_COMPARE_WITH_TIMEOUT(failed.count(), 2, 30000);
+    for (const auto &arguments : qAsConst(failed)) {
+        QCOMPARE(arguments.at(0).value<ChannelId>().value(), ids.at(1).value());
+    }
+    QCOMPARE(Database::instance().programCount(ids.at(0)), static_cast<size_t>(2 * programsPerDay));
+    QCOMPARE(Database::instance().programCount(ids.at(1)), static_cast<size_t>(0));
+}
+
+void TvSpielfilmFetcherTest::skipFetchedDays()
+{
+    const QVector<ChannelId> ids = channelIds(2);
+    TvSpielfilmFetcher fetcher;
+    QSignalSpy updated(&fetcher, &FetcherImpl::channelUpdated);
+    fetcher.fetchPrograms(ids, FetchPriority::Normal);
+    QTRY_COMPARE_WITH_TIMEOUT(updated.count(), 2 * ids.size(), 30000);
+
+    // the days are fetched, no matter when their last program ends
+    const int requestCount = m_server->requestCount();
+    fetcher.fetchPrograms(ids, FetchPriority::Normal);
+    QTest::qWait(100);
+    QCOMPARE(m_server->requestCount(), requestCount);
+    QCOMPARE(updated.count(), 2 * ids.size());
+}
+
+void TvSpielfilmFetcherTest::benchmarkRefresh_data()
+{
+    QTest::addColumn<int>("favoriteCount");
+
+    QTest::newRow("10 favorites") << 10;
+    QTest::newRow("100 favorites") << 100;
+    QTest::newRow("500 favorites") << 500;
+}
+
+void TvSpielfilmFetcherTest::benchmarkRefresh()
+{
+    QFETCH(int, favoriteCount);
+
+    // full refresh: fetch, parse and store all pages
+    const QVector<ChannelId> ids = channelIds(favoriteCount);
+    TvSpielfilmFetcher fetcher;
+    QSignalSpy updated(&fetcher, &FetcherImpl::channelUpdated);
+    QBENCHMARK {
+        clearPrograms();
+        updated.clear();
+        const FrameMonitor monitor(QStringLiteral("Refresh of %1 favorites").arg(favoriteCount));
+        fetcher.fetchPrograms(ids, FetchPriority::Normal);
+        QTRY_COMPARE_WITH_TIMEOUT(updated.count(), 2 * ids.size(), 600000);
+    }
+}
+
+void TvSpielfilmFetcherTest::clearPrograms()
+{
+    // every refresh fetches all days
+    QSqlQuery query(QSqlDatabase::database());
+    QVERIFY(query.exec(QStringLiteral("DELETE FROM ProgramCategories;")));
+    QVERIFY(query.exec(QStringLiteral("DELETE FROM Programs;")));
+    QVERIFY(query.exec(QStringLiteral("DELETE FROM FetchedDays;")));
+}
+
+QTEST_GUILESS_MAIN(TvSpielfilmFetcherTest)
+
+#include "tvspielfilmfetchertest.moc"
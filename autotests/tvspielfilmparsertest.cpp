@@ -0,0 +1,320 @@
+// SPDX-FileCopyrightText: none
+// SPDX-License-Identifier: GPL-3.0-only
+
+#include "tvspielfilmparser.h"
+
+#include <QFile>
+#include <QRandomGenerator>
+#include <QTest>
+
+namespace
+{
+const QString programUrl = QStringLiteral("https://www.tvspielfilm.de/tv-programm/sendungen/?time=day&channel=ARD&date=2022-11-10&page=");
+
+QByteArray readFile(const QString &fileName)
+{
+    QFile file(fileName);
+    if (!file.open(QIODevice::ReadOnly)) {
+        return QByteArray();
+    }
+    return file.readAll();
+}
+
+// start|stop|date|description URL|title|category
+QString toString(const TvSpielfilmParser::ProgramRow &row)
+{
+    return QStringList{row.startTime, row.stopTime, row.date, row.descriptionUrl, row.title, row.category}.join(QLatin1Char('|'));
+}
+
+QStringList toStrings(const QVector<TvSpielfilmParser::ProgramRow> &rows)
+{
+    QStringList result;
+    for (const auto &row : rows) {
+        result.push_back(toString(row));
+    }
+    return result;
+}
+
+QByteArray row(const QByteArray &time, const QByteArray &links, const QByteArray &category)
+{
+    return "<td class=\"col-1\"><a href=\"https://www.tvspielfilm.de/tv-programm/sendungen/das-erste,ARD.html\">Das Erste</a></td>\n"
+           "<td class=\"col-2\"><a href=\"https://www.tvspielfilm.de/tv-programm/sendung/tagesschau,1.html\"><strong>"
+        + time + "</strong> <span>Do 10.11.</span></a></td>\n<td class=\"col-3\"><span>" + links
+        + "<strong>Tagesschau</strong></a></span></td>\n"
+          "<td class=\"col-4\">"
+        + category + "</td>\n";
+}
+}
+
+class TvSpielfilmParserTest : public QObject
+{
+    Q_OBJECT
+
+private Q_SLOTS:
+    void parseRow_data();
+    void parseRow();
+    void parsePagination_data();
+    void parsePagination();
+    void parseDescription_data();
+    void parseDescription();
+    void parseChannels();
+    void parseProgramPage_data();
+    void parseProgramPage();
+    void addData_data();
+    void addData();
+    void addDataRandomPieces();
+    void rowsBeforeEndOfPage();
+    void benchmarkParse_data();
+    void benchmarkParse();
+};
+
+void TvSpielfilmParserTest::parseRow_data()
+{
+    QTest::addColumn<QByteArray>("row");
+    QTest::addColumn<bool>("valid");
+    QTest::addColumn<QString>("expected");
+
+    const QByteArray link("<a href=\"https://www.tvspielfilm.de/tv-programm/sendung/tagesschau,1.html\" title=\"Tagesschau\">");
+    const QString expected = QStringLiteral("20:00|20:15|10.11.|https://www.tvspielfilm.de/tv-programm/sendung/tagesschau,1.html|Tagesschau|Nachrichten");
+
+    QTest::newRow("complete") << row("20:00 - 20:15", link, "<span>Nachrichten</span>") << true << expected;
+    QTest::newRow("other link first") << row("20:00 - 20:15", "<a href=\"https://www.tvspielfilm.de/news/\">News</a>" + link, "<span>Nachrichten</span>")
+                                      << true << expected;
+    QTest::newRow("empty category") << row("20:00 - 20:15", link, "<span></span>") << true << expected.left(expected.lastIndexOf(QLatin1Char('|')) + 1);
+    QTest::newRow("no description link") << row("20:00 - 20:15", "<a href=\"https://www.tvspielfilm.de/news/\">", "<span>Nachrichten</span>") << false
+                                         << QString();
+    QTest::newRow("no stop time") << row("20:00", link, "<span>Nachrichten</span>") << false << QString();
+    QTest::newRow("no category") << row("20:00 - 20:15", link, QByteArray()) << false << QString();
+    QTest::newRow("ad") << QByteArray("<td class=\"col-1\" colspan=\"6\"><div class=\"ad-container\"></div></td>") << false << QString();
+}
+
+void TvSpielfilmParserTest::parseRow()
+{
+    QFETCH(QByteArray, row);
+    QFETCH(bool, valid);
+    QFETCH(QString, expected);
+
+    TvSpielfilmParser::ProgramRow data;
+    QCOMPARE(TvSpielfilmParser::parseRow(row, data), valid);
+    if (valid) {
+        QCOMPARE(toString(data), expected);
+    }
+}
+
+void TvSpielfilmParserTest::parsePagination_data()
+{
+    QTest::addColumn<QByteArray>("pagination");
+    QTest::addColumn<QStringList>("pageUrls");
+    QTest::addColumn<QString>("nextPageUrl");
+
+    const QByteArray url("https://www.tvspielfilm.de/tv-programm/sendungen/?time=day&amp;channel=ARD&amp;date=2022-11-10&amp;page=");
+
+    QTest::newRow("first page") << QByteArray("<li><a class=\"pagination__link pagination__link--current\" href=\"" + url + "1\">1</a></li>"
+                                              "<li><a class=\"pagination__link\" href=\"" + url + "2\">2</a></li>"
+                                              "<li><a class=\"pagination__link pagination__link--next\" href=\"" + url + "2\" rel=\"next\">Weiter</a></li>")
+                                << QStringList{programUrl + "1", programUrl + "2", programUrl + "2"} << QString(programUrl + "2");
+    QTest::newRow("last page") << QByteArray("<li><a class=\"pagination__link\" href=\"" + url + "1\">1</a></li>"
+                                             "<li><a class=\"pagination__link pagination__link--current\" href=\"" + url + "2\">2</a></li>")
+                               << QStringList{programUrl + "1", programUrl + "2"} << QString();
+    QTest::newRow("link without href") << QByteArray("<li><a class=\"pagination__link pagination__link--next\">Weiter</a></li>") << QStringList()
+                                       << QString();
+    QTest::newRow("empty") << QByteArray() << QStringList() << QString();
+}
+
+void TvSpielfilmParserTest::parsePagination()
+{
+    QFETCH(QByteArray, pagination);
+    QFETCH(QStringList, pageUrls);
+    QFETCH(QString, nextPageUrl);
+
+    TvSpielfilmParser::ProgramPage page;
+    TvSpielfilmParser::parsePagination(pagination, page);
+    QCOMPARE(page.pageUrls, pageUrls);
+    QCOMPARE(page.nextPageUrl, nextPageUrl);
+}
+
+void TvSpielfilmParserTest::parseDescription_data()
+{
+    QTest::addColumn<QByteArray>("page");
+    QTest::addColumn<QString>("description");
+
+    QTest::newRow("recorded") << readFile(QFINDTESTDATA("data/tvspielfilm/description.html"))
+                              << QString::fromUtf8("Nachrichten aus dem In- und Ausland, präsentiert vom Team der Tagesschau.");
+    QTest::newRow("program page") << readFile(QFINDTESTDATA("data/tvspielfilm/programs-page1.html")) << QString();
+    QTest::newRow("empty") << QByteArray() << QString();
+}
+
+void TvSpielfilmParserTest::parseDescription()
+{
+    QFETCH(QByteArray, page);
+    QFETCH(QString, description);
+
+    const QString parsed = TvSpielfilmParser::parseDescription(page);
+    QCOMPARE(parsed, description);
+    QCOMPARE(parsed.isNull(), description.isNull());
+}
+
+void TvSpielfilmParserTest::parseChannels()
+{
+    const QVector<TvSpielfilmParser::ChannelOption> channels = TvSpielfilmParser::parseChannels(readFile(QFINDTESTDATA("data/tvspielfilm/programs-page1.html")));
+    QCOMPARE(channels.size(), 15);
+    QCOMPARE(channels.at(0).id, QStringLiteral("g:1"));
+    QCOMPARE(channels.at(1).id, QStringLiteral("ARD"));
+    QCOMPARE(channels.at(1).name, QStringLiteral("Das Erste"));
+    QCOMPARE(channels.at(14).id, QStringLiteral("NDR"));
+}
+
+void TvSpielfilmParserTest::parseProgramPage_data()
+{
+    QTest::addColumn<QString>("fileName");
+    QTest::addColumn<int>("rowCount");
+    QTest::addColumn<QString>("firstRow");
+    QTest::addColumn<QString>("lastRow");
+    QTest::addColumn<QStringList>("pageUrls");
+    QTest::addColumn<QString>("nextPageUrl");
+
+    const QString descriptionUrl = QStringLiteral("https://www.tvspielfilm.de/tv-programm/sendung/");
+
+    // the ad between the programs is skipped
+    QTest::newRow("first page") << QStringLiteral("data/tvspielfilm/programs-page1.html") << 6
+                                << "05:30|06:00|10.11.|" + descriptionUrl + "tagesschau,6368f1e18183a8f0543ad5a0.html|Tagesschau|Nachrichten"
+                                << "12:00|14:00|10.11.|" + descriptionUrl + "mittagsmagazin,6368f1e18183a8f0543ad5a5.html|ARD-Mittagsmagazin|Magazin"
+                                << QStringList{programUrl + "1", programUrl + "2", programUrl + "2"} << QString(programUrl + "2");
+    QTest::newRow("last page") << QStringLiteral("data/tvspielfilm/programs-page2.html") << 4
+                               << "14:00|15:10|10.11.|" + descriptionUrl + "rote-rosen,6368f1e18183a8f0543ad5a6.html|Rote Rosen|Serie"
+                               << "23:35|01:05|10.11.|" + descriptionUrl + "nachtfilm,6368f1e18183a8f0543ad5a9.html|Nachtfilm|"
+                               << QStringList{programUrl + "1", programUrl + "2"} << QString();
+}
+
+void TvSpielfilmParserTest::parseProgramPage()
+{
+    QFETCH(QString, fileName);
+    QFETCH(int, rowCount);
+    QFETCH(QString, firstRow);
+    QFETCH(QString, lastRow);
+    QFETCH(QStringList, pageUrls);
+    QFETCH(QString, nextPageUrl);
+
+    const TvSpielfilmParser::ProgramPage page = TvSpielfilmParser::parseProgramPage(readFile(QFINDTESTDATA(fileName)));
+    QCOMPARE(page.rows.size(), rowCount);
+    QCOMPARE(toString(page.rows.first()), firstRow);
+    QCOMPARE(toString(page.rows.last()), lastRow);
+    QCOMPARE(page.pageUrls, pageUrls);
+    QCOMPARE(page.nextPageUrl, nextPageUrl);
+}
+
+void TvSpielfilmParserTest::addData_data()
+{
+    QTest::addColumn<QString>("fileName");
+    QTest::addColumn<int>("pieceSize");
+
+    const QStringList fileNames{QStringLiteral("data/tvspielfilm/programs-page1.html"), QStringLiteral("data/tvspielfilm/programs-page2.html")};
+    for (const QString &fileName : fileNames) {
+        for (const int pieceSize : {1, 2, 3, 7, 17, 64, 1000, 1 << 20}) {
+            QTest::newRow(qPrintable(fileName.section(QLatin1Char('/'), -1) + " " + QString::number(pieceSize))) << fileName << pieceSize;
+        }
+    }
+}
+
+void TvSpielfilmParserTest::addData()
+{
+    QFETCH(QString, fileName);
+    QFETCH(int, pieceSize);
+
+    const QByteArray data = readFile(QFINDTESTDATA(fileName));
+    QVERIFY(!data.isEmpty());
+    const TvSpielfilmParser::ProgramPage expected = TvSpielfilmParser::parseProgramPage(data);
+
+    // the rows are taken while the data arrives (as the fetcher does)
+    TvSpielfilmParser::ProgramPageReader reader;
+    QVector<TvSpielfilmParser::ProgramRow> rows;
+    for (int pos = 0; pos < data.size(); pos += pieceSize) {
+        reader.addData(data.mid(pos, pieceSize));
+        rows += reader.takeRows();
+    }
+
+    QCOMPARE(toStrings(rows), toStrings(expected.rows));
+    QVERIFY(reader.hasPagination());
+    QCOMPARE(reader.page().pageUrls, expected.pageUrls);
+    QCOMPARE(reader.page().nextPageUrl, expected.nextPageUrl);
+}
+
+void TvSpielfilmParserTest::addDataRandomPieces()
+{
+    const QByteArray data = readFile(QFINDTESTDATA("data/tvspielfilm/programs-page1.html"));
+    QVERIFY(!data.isEmpty());
+    const QStringList expected = toStrings(TvSpielfilmParser::parseProgramPage(data).rows);
+
+    // reproducible
+    QRandomGenerator random(42);
+    for (int round = 0; round < 50; ++round) {
+        TvSpielfilmParser::ProgramPageReader reader;
+        QVector<TvSpielfilmParser::ProgramRow> rows;
+        for (int pos = 0; pos < data.size();) {
+            const int pieceSize = random.bounded(1, 100);
+            reader.addData(data.mid(pos, pieceSize));
+            pos += pieceSize;
+            if (random.bounded(2) == 0) {
+                rows += reader.takeRows();
+            }
+        }
+        rows += reader.takeRows();
+
+        QCOMPARE(toStrings(rows), expected);
+        QVERIFY(reader.hasPagination());
+    }
+}
+
+void TvSpielfilmParserTest::rowsBeforeEndOfPage()
+{
+    const QByteArray data = readFile(QFINDTESTDATA("data/tvspielfilm/programs-page1.html"));
+    const int firstRowEnd = data.indexOf("</tr>", data.indexOf("<tr class=\"hover\">"));
+    QVERIFY(firstRowEnd > 0);
+
+    TvSpielfilmParser::ProgramPageReader reader;
+    reader.addData(data.left(firstRowEnd));
+    QVERIFY(reader.takeRows().isEmpty());
+
+    // complete as soon as the end tag has arrived
+    reader.addData(data.mid(firstRowEnd, 5));
+    QCOMPARE(reader.takeRows().size(), 1);
+    QVERIFY(!reader.hasPagination());
+}
+
+void TvSpielfilmParserTest::benchmarkParse_data()
+{
+    QTest::addColumn<int>("pieceSize"); // 0: complete page
+
+    QTest::newRow("complete page") << 0;
+    QTest::newRow("1400 byte pieces") << 1400;
+    QTest::newRow("16 KiB pieces") << 16 * 1024;
+}
+
+void TvSpielfilmParserTest::benchmarkParse()
+{
+    QFETCH(int, pieceSize);
+
+    // parser throughput per fetched page (without network and database)
+    const QByteArray data = readFile(QFINDTESTDATA("data/tvspielfilm/programs-page1.html"));
+    QVERIFY(!data.isEmpty());
+    int rowCount = 0;
+    if (pieceSize == 0) {
+        QBENCHMARK {
+            rowCount = TvSpielfilmParser::parseProgramPage(data).rows.size();
+        }
+    } else {
+        QBENCHMARK {
+            TvSpielfilmParser::ProgramPageReader reader;
+            rowCount = 0;
+            for (int pos = 0; pos < data.size(); pos += pieceSize) {
+                reader.addData(data.mid(pos, pieceSize));
+                rowCount += reader.takeRows().size();
+            }
+        }
+    }
+    QCOMPARE(rowCount, 6);
+}
+
+QTEST_GUILESS_MAIN(TvSpielfilmParserTest)
+
+#include "tvspielfilmparsertest.moc"
@@ -0,0 +1,362 @@
+// SPDX-FileCopyrightText: none
+// SPDX-License-Identifier: GPL-3.0-only
+
+#include "TellySkoutSettings.h"
+#include "categories.h"
+#include "database.h"
+#include "framemonitor.h"
+#include "xmltvfetcher.h"
+
+#include <QDateTime>
+#include <QDir>
+#include <QFile>
+#include <QSignalSpy>
+#include <QSqlDatabase>
+#include <QSqlQuery>
+#include <QSqlRecord>
+#include <QStandardPaths>
+#include <QTemporaryDir>
+#include <QTest>
+
+// signal arguments recorded by QSignalSpy
+Q_DECLARE_METATYPE(ChannelId)
+Q_DECLARE_METATYPE(Error)
+
+namespace
+{
+// requested channels of writeLargeFile()
+const QVector<ChannelId> largeFileChannels{ChannelId(QStringLiteral("c0")), ChannelId(QStringLiteral("c1")), ChannelId(QStringLiteral("c2")), ChannelId(QStringLiteral("c3"))};
+
+// the time parser before XmltvFetcher::parseTime() (for comparison)
+QDateTime parseTimeWithQDateTime(const QString &timeString)
+{
+    QDateTime time = QDateTime::fromString(timeString.left(14), QStringLiteral("yyyyMMddHHmmss"));
+    const int timeOffset = timeString.right(5).leftRef(3).toInt();
+    time.setOffsetFromUtc(timeOffset * 3600);
+    return time.toUTC();
+}
+}
+
+class XmltvFetcherTest : public QObject
+{
+    Q_OBJECT
+
+private Q_SLOTS:
+    void initTestCase();
+    void init();
+    void importSample_data();
+    void importSample();
+    void importChunks();
+    void changeFiles();
+    void parseTime_data();
+    void parseTime();
+    void benchmarkParseTime_data();
+    void benchmarkParseTime();
+    void benchmarkImport();
+    void benchmarkParallelImport_data();
+    void benchmarkParallelImport();
+
+private:
+    void import(const QString &fileName, const QVector<ChannelId> &channelIds, int threadCount, int batchSize = 1000);
+    QString writeLargeFile(int programCount);
+    QString dump() const;
+
+    QTemporaryDir m_dir;
+};
+
+void XmltvFetcherTest::initTestCase()
+{
+    qRegisterMetaType<ChannelId>();
+    qRegisterMetaType<Error>();
+
+    QVERIFY(m_dir.isValid());
+
+    // fresh settings and database (in ~/.qttest)
+    QStandardPaths::setTestModeEnabled(true);
+    QFile::remove(QStandardPaths::writableLocation(QStandardPaths::GenericConfigLocation) + QStringLiteral("/tellyskoutrc"));
+    QDir(QStandardPaths::writableLocation(QStandardPaths::AppDataLocation)).removeRecursively();
+
+    TellySkoutSettings settings;
+    settings.setFetcher(TellySkoutSettings::EnumFetcher::XMLTV);
+    settings.save();
+
+    Database::instance(); // creates the tables
+}
+
+void XmltvFetcherTest::init()
+{
+    // every import starts with empty tables (the program keys and category IDs start at the beginning)
+    QSqlQuery query(QSqlDatabase::database());
+    QVERIFY(query.exec(QStringLiteral("DELETE FROM ProgramCategories;")));
+    QVERIFY(query.exec(QStringLiteral("DELETE FROM Programs;")));
+    QVERIFY(query.exec(QStringLiteral("DELETE FROM Categories;")));
+    QVERIFY(query.exec(QStringLiteral("DELETE FROM ImportFingerprints;")));
+    Categories::instance().load(QVector<QString>());
+    Database::instance().clearFavorites();
+}
+
+void XmltvFetcherTest::importSample_data()
+{
+    QTest::addColumn<int>("threadCount");
+
+    // the sample is imported in one piece in both cases (too small to be split, see importChunks())
+    QTest::newRow("serial") << 1;
+    QTest::newRow("parallel") << 4;
+}
+
+void XmltvFetcherTest::importSample()
+{
+    QFETCH(int, threadCount);
+
+    const QString fileName = QFINDTESTDATA("data/xmltv/sample.xml");
+    QVERIFY(!fileName.isEmpty());
+    QFile golden(QFINDTESTDATA("data/xmltv/sample.dump"));
+    QVERIFY(golden.open(QIODevice::ReadOnly | QIODevice::Text));
+
+    // "skip.example" is not requested
+    import(fileName, {ChannelId(QStringLiteral("one.example")), ChannelId(QStringLiteral("two.example")), ChannelId(QStringLiteral("three.example"))}, threadCount);
+    if (QTest::currentTestFailed()) {
+        return;
+    }
+
+    QCOMPARE(dump(), QString::fromUtf8(golden.readAll()));
+}
+
+void XmltvFetcherTest::importChunks()
+{
+    // large enough to be split into chunks which are parsed concurrently
+    const QString fileName = writeLargeFile(16000);
+
+    import(fileName, largeFileChannels, 1);
+    if (QTest::currentTestFailed()) {
+        return;
+    }
+    const QString serial = dump();
+    QVERIFY(serial.contains(QStringLiteral("\tc3_")));
+
+    init();
+    import(fileName, largeFileChannels, 4);
+    if (QTest::currentTestFailed()) {
+        return;
+    }
+    QCOMPARE(dump(), serial);
+}
+
+void XmltvFetcherTest::changeFiles()
+{
+    const QVector<ChannelId> ids{ChannelId(QStringLiteral("one.example")), ChannelId(QStringLiteral("two.example")), ChannelId(QStringLiteral("three.example"))};
+    for (const auto &id : ids) {
+        Database::instance().addFavorite(id);
+    }
+
+    // without programs
+    QFile empty(m_dir.filePath(QStringLiteral("empty.xml")));
+    QVERIFY(empty.open(QIODevice::WriteOnly));
+    empty.write("<?xml version=\"1.0\" encoding=\"UTF-8\"?>\n<tv>\n</tv>\n");
+    empty.close();
+
+    TellySkoutSettings settings;
+    settings.setXmltvFiles(QStringList{empty.fileName()});
+    settings.save();
+
+    XmltvFetcher fetcher;
+    QSignalSpy updated(&fetcher, &FetcherImpl::channelUpdated);
+
+    // the favorites are imported from the new file without a request
+    settings.setXmltvFiles(QStringList{QFINDTESTDATA("data/xmltv/sample.xml")});
+    settings.save();
+    fetcher.settingsChanged();
+
+    QTRY_COMPARE_WITH_TIMEOUT(updated.count(), ids.size(), 60000);
+    for (const auto &id : ids) {
+        QVERIFY(Database::instance().programCount(id) > 0);
+    }
+
+    // unchanged
+    fetcher.settingsChanged();
+    QTest::qWait(100);
+    QCOMPARE(updated.count(), ids.size());
+}
+
+void XmltvFetcherTest::parseTime_data()
+{
+    QTest::addColumn<QString>("time");
+    QTest::addColumn<bool>("valid");
+    QTest::addColumn<QDateTime>("expected");
+
+    const QDate day(2022, 11, 10);
+    QTest::newRow("offset") << QStringLiteral("20221110201500 +0100") << true << QDateTime(day, QTime(19, 15), Qt::UTC);
+    QTest::newRow("offset with minutes") << QStringLiteral("20221110201500 +0530") << true << QDateTime(day, QTime(14, 45), Qt::UTC);
+    QTest::newRow("negative offset") << QStringLiteral("20221110201500 -0030") << true << QDateTime(day, QTime(20, 45), Qt::UTC);
+    QTest::newRow("without offset") << QStringLiteral("20221110201500") << true << QDateTime(day, QTime(20, 15), Qt::UTC);
+    QTest::newRow("time zone name") << QStringLiteral("20221110201500 CET") << true << QDateTime(day, QTime(20, 15), Qt::UTC);
+    QTest::newRow("without seconds") << QStringLiteral("202211102015 +0100") << true << QDateTime(day, QTime(19, 15), Qt::UTC);
+    QTest::newRow("year only") << QStringLiteral("2022") << true << QDateTime(QDate(2022, 1, 1), QTime(0, 0), Qt::UTC);
+    QTest::newRow("before 1970") << QStringLiteral("19691231235959 +0000") << true << QDateTime(QDate(1969, 12, 31), QTime(23, 59, 59), Qt::UTC);
+    QTest::newRow("leap day") << QStringLiteral("20240229120000") << true << QDateTime(QDate(2024, 2, 29), QTime(12, 0), Qt::UTC);
+    QTest::newRow("empty") << QString() << false << QDateTime();
+    QTest::newRow("invalid month") << QStringLiteral("20221310201500 +0100") << false << QDateTime();
+    QTest::newRow("incomplete field") << QStringLiteral("2022111") << false << QDateTime();
+    QTest::newRow("invalid offset") << QStringLiteral("20221110201500 +01x") << false << QDateTime();
+}
+
+void XmltvFetcherTest::parseTime()
+{
+    QFETCH(QString, time);
+    QFETCH(bool, valid);
+    QFETCH(QDateTime, expected);
+
+    qint64 secsSinceEpoch = 0;
+    QCOMPARE(XmltvFetcher::parseTime(QStringRef(&time), secsSinceEpoch), valid);
+    if (valid) {
+        QCOMPARE(secsSinceEpoch, expected.toSecsSinceEpoch());
+    }
+}
+
+void XmltvFetcherTest::benchmarkParseTime_data()
+{
+    QTest::addColumn<bool>("allocationFree");
+
+    QTest::newRow("QDateTime::fromString") << false;
+    QTest::newRow("XmltvFetcher::parseTime") << true;
+}
+
+void XmltvFetcherTest::benchmarkParseTime()
+{
+    QFETCH(bool, allocationFree);
+
+    // start and stop of 1000 programs (as attribute values)
+    const QString time = QStringLiteral("20221110201500 +0100");
+    const QStringRef attribute(&time);
+    qint64 sum = 0;
+    if (allocationFree) {
+        QBENCHMARK {
+            for (int i = 0; i < 2000; ++i) {
+                qint64 secsSinceEpoch = 0;
+                XmltvFetcher::parseTime(attribute, secsSinceEpoch);
+                sum += secsSinceEpoch;
+            }
+        }
+    } else {
+        QBENCHMARK {
+            for (int i = 0; i < 2000; ++i) {
+                sum += parseTimeWithQDateTime(attribute.toString()).toSecsSinceEpoch();
+            }
+        }
+    }
+    QVERIFY(sum != 0);
+}
+
+void XmltvFetcherTest::benchmarkImport()
+{
+    // parsing, comparing with the stored programs and storing them
+    const QString fileName = writeLargeFile(16000);
+    QBENCHMARK {
+        init();
+        import(fileName, largeFileChannels, 1);
+    }
+}
+
+void XmltvFetcherTest::benchmarkParallelImport_data()
+{
+    QTest::addColumn<int>("threadCount");
+    QTest::addColumn<int>("batchSize");
+
+    for (int threadCount : {1, 2, 4, 8}) {
+        for (int batchSize : {100, 1000, 10000}) {
+            QTest::addRow("%d threads, batch size %d", threadCount, batchSize) << threadCount << batchSize;
+        }
+    }
+}
+
+void XmltvFetcherTest::benchmarkParallelImport()
+{
+    QFETCH(int, threadCount);
+    QFETCH(int, batchSize);
+
+    // ~13 MiB, i.e. enough chunks for all threads
+    const QString fileName = writeLargeFile(32000);
+    QBENCHMARK {
+        init();
+        import(fileName, largeFileChannels, threadCount, batchSize);
+    }
+}
+
+void XmltvFetcherTest::import(const QString &fileName, const QVector<ChannelId> &channelIds, int threadCount, int batchSize)
+{
+    TellySkoutSettings settings;
+    settings.setXmltvFiles(QStringList{fileName});
+    settings.setXmltvImportThreads(static_cast<uint>(threadCount));
+    settings.setXmltvBatchSize(static_cast<uint>(batchSize));
+    settings.save();
+
+    XmltvFetcher fetcher;
+    QSignalSpy updated(&fetcher, &FetcherImpl::channelUpdated);
+    QSignalSpy failed(&fetcher, &FetcherImpl::errorFetchingChannel);
+
+    const FrameMonitor monitor(QStringLiteral("Import with %1 threads").arg(threadCount));
+    fetcher.fetchPrograms(channelIds, FetchPriority::Normal);
+
+    // all channels have changed (empty tables)
+    QTRY_COMPARE_WITH_TIMEOUT(updated.count(), channelIds.size(), 60000);
+    QCOMPARE(failed.count(), 0);
+}
+
+QString XmltvFetcherTest::writeLargeFile(int programCount)
+{
+    QFile file(m_dir.filePath(QStringLiteral("large.xml")));
+    if (!file.open(QIODevice::WriteOnly)) {
+        return QString();
+    }
+
+    const QByteArray filler(200, 'x');
+    const qint64 first = QDateTime(QDate(2022, 11, 10), QTime(0, 0), Qt::UTC).toSecsSinceEpoch();
+
+    file.write("<?xml version=\"1.0\" encoding=\"UTF-8\"?>\n<tv>\n");
+    for (int i = 0; i < programCount; ++i) {
+        // channel c4 is not requested, more categories than fit into the mask
+        const QByteArray channel = "c" + QByteArray::number(i % 5);
+        const qint64 start = first + (i / 5) * 1800;
+        file.write("  <programme start=\"" + QDateTime::fromSecsSinceEpoch(start, Qt::UTC).toString(QStringLiteral("yyyyMMddhhmmss")).toLatin1()
+                   + " +0000\" stop=\"" + QDateTime::fromSecsSinceEpoch(start + 1800, Qt::UTC).toString(QStringLiteral("yyyyMMddhhmmss")).toLatin1()
+                   + " +0000\" channel=\"" + channel + "\">\n");
+        file.write("    <title>Program " + QByteArray::number(i) + "</title>\n");
+        file.write("    <desc>" + filler + "</desc>\n");
+        file.write("    <category>Category " + QByteArray::number(i % 7) + "</category>\n");
+        file.write("    <category>Category " + QByteArray::number((i * i) % 97) + "</category>\n");
+        file.write("  </programme>\n");
+    }
+    file.write("</tv>\n");
+
+    return file.fileName();
+}
+
+QString XmltvFetcherTest::dump() const
+{
+    const QStringList queries{
+        QStringLiteral("SELECT key, id, url, channel, start, stop, title, subtitle, description, descriptionFetched, categories FROM Programs ORDER BY key;"),
+        QStringLiteral("SELECT program, category FROM ProgramCategories ORDER BY program, category;"),
+        QStringLiteral("SELECT id, name FROM Categories ORDER BY id;")};
+    const QStringList tables{QStringLiteral("Programs"), QStringLiteral("ProgramCategories"), QStringLiteral("Categories")};
+
+    QString result;
+    for (int i = 0; i < queries.size(); ++i) {
+        result += tables.at(i) + "\n";
+        QSqlQuery query(QSqlDatabase::database());
+        if (!query.exec(queries.at(i))) {
+            return QString();
+        }
+        while (query.next()) {
+            QStringList values;
+            for (int column = 0; column < query.record().count(); ++column) {
+                values.push_back(query.isNull(column) ? QStringLiteral("NULL") : query.value(column).toString());
+            }
+            result += values.join(QLatin1Char('\t')) + "\n";
+        }
+    }
+    return result;
+}
+
+QTEST_GUILESS_MAIN(XmltvFetcherTest)
+
+#include "xmltvfetchertest.moc"
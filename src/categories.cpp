@@ -0,0 +1,130 @@
+// SPDX-FileCopyrightText: none
+// SPDX-License-Identifier: GPL-3.0-only
+
+#include "categories.h"
+
+#include <QMutexLocker>
+
+#include <algorithm>
+
+CategorySet::CategorySet(quint64 mask, const QVector<CategoryId> &overflow)
+    : m_mask(mask)
+    , m_overflow(overflow)
+{
+    std::sort(m_overflow.begin(), m_overflow.end());
+}
+
+void CategorySet::insert(CategoryId id)
+{
+    if (id < 0) {
+        return;
+    }
+    if (id < maskSize) {
+        m_mask |= quint64(1) << id;
+        return;
+    }
+    const auto it = std::lower_bound(m_overflow.begin(), m_overflow.end(), id);
+    if (it == m_overflow.end() || *it != id) {
+        m_overflow.insert(it, id);
+    }
+}
+
+bool CategorySet::contains(CategoryId id) const
+{
+    if (id < 0) {
+        return false;
+    }
+    if (id < maskSize) {
+        return (m_mask & (quint64(1) << id)) != 0;
+    }
+    return std::binary_search(m_overflow.cbegin(), m_overflow.cend(), id);
+}
+
+bool CategorySet::isEmpty() const
+{
+    return m_mask == 0 && m_overflow.isEmpty();
+}
+
+QVector<CategoryId> CategorySet::ids() const
+{
+    QVector<CategoryId> result;
+    for (CategoryId id = 0; id < maskSize; ++id) {
+        if ((m_mask & (quint64(1) << id)) != 0) {
+            result.push_back(id);
+        }
+    }
+    result += m_overflow;
+    return result;
+}
+
+quint64 CategorySet::mask() const
+{
+    return m_mask;
+}
+
+const QVector<CategoryId> &CategorySet::overflow() const
+{
+    return m_overflow;
+}
+
+void Categories::load(const QVector<QString> &names)
+{
+    QMutexLocker locker(&m_mutex);
+    m_names = names;
+    m_ids.clear();
+    for (int i = 0; i < m_names.size(); ++i) {
+        if (!m_names.at(i).isNull()) {
+            m_ids.insert(m_names.at(i), i);
+        }
+    }
+    m_storedCount = m_names.size();
+}
+
+CategoryId Categories::id(const QString &name)
+{
+    QMutexLocker locker(&m_mutex);
+    const auto it = m_ids.constFind(name);
+    if (it != m_ids.cend()) {
+        return *it;
+    }
+    const CategoryId id = m_names.size();
+    m_names.push_back(name);
+    m_ids.insert(name, id);
+    return id;
+}
+
+QString Categories::name(CategoryId id) const
+{
+    QMutexLocker locker(&m_mutex);
+    return m_names.value(id);
+}
+
+QVector<QString> Categories::names(const CategorySet &categories) const
+{
+    const QVector<CategoryId> ids = categories.ids();
+
+    QMutexLocker locker(&m_mutex);
+    QVector<QString> result;
+    result.reserve(ids.size());
+    for (const CategoryId id : ids) {
+        result.push_back(m_names.value(id));
+    }
+    return result;
+}
+
+QVector<QPair<CategoryId, QString>> Categories::takeUnstored()
+{
+    QMutexLocker locker(&m_mutex);
+    QVector<QPair<CategoryId, QString>> unstored;
+    for (int i = m_storedCount; i < m_names.size(); ++i) {
+        unstored.push_back(qMakePair(i, m_names.at(i)));
+    }
+    m_storedCount = m_names.size();
+    return unstored;
+}
+
+void Categories::markUnstored()
+{
+    QMutexLocker locker(&m_mutex);
+    m_storedCount = 0;
+}
@@ -0,0 +1,72 @@
+// SPDX-FileCopyrightText: none
+// SPDX-License-Identifier: GPL-3.0-only
+
+#pragma once
+
+#include <QHash>
+#include <QMutex>
+#include <QPair>
+#include <QString>
+#include <QVector>
+
+using CategoryId = int;
+
+// categories of a program
+// IDs < 64 (i.e. the usual case: few, frequent categories) are stored as bits, higher IDs in a list
+class CategorySet
+{
+public:
+    static const CategoryId maskSize = 64;
+
+    CategorySet() = default;
+    CategorySet(quint64 mask, const QVector<CategoryId> &overflow);
+
+    void insert(CategoryId id);
+    bool contains(CategoryId id) const;
+    bool isEmpty() const;
+    QVector<CategoryId> ids() const; // ascending
+
+    quint64 mask() const;
+    const QVector<CategoryId> &overflow() const; // ascending
+
+private:
+    quint64 m_mask = 0;
+    QVector<CategoryId> m_overflow;
+
+    friend bool operator==(const CategorySet &l, const CategorySet &r)
+    {
+        return l.m_mask == r.m_mask && l.m_overflow == r.m_overflow;
+    }
+
+    friend bool operator!=(const CategorySet &l, const CategorySet &r)
+    {
+        return !(l == r);
+    }
+};
+
+// dictionary of the category names (the IDs are stored in the database)
+// thread-safe (used by the parsers in worker threads)
+class Categories
+{
+public:
+    static Categories &instance()
+    {
+        static Categories _instance;
+        return _instance;
+    }
+
+    void load(const QVector<QString> &names); // stored names (index = ID)
+    CategoryId id(const QString &name); // adds unknown names
+    QString name(CategoryId id) const;
+    QVector<QString> names(const CategorySet &categories) const;
+    QVector<QPair<CategoryId, QString>> takeUnstored(); // added since load() or the last call
+    void markUnstored(); // e.g. the table has been dropped (the IDs stay valid)
+
+private:
+    Categories() = default;
+
+    mutable QMutex m_mutex;
+    QHash<QString, CategoryId> m_ids;
+    QVector<QString> m_names; // index = ID
+    int m_storedCount = 0;
+};
@@ -5,6 +5,7 @@
 
 #include "channel.h"
 #include "database.h"
+#include "databasewriter.h"
 #include "fetcher.h"
 
 #include <QDebug>
@@ -114,11 +115,14 @@ void ChannelsModel::loadChannel(int index) const
 
 void ChannelsModel::setFavorite(const QString &channelId, bool favorite)
 {
-    if (favorite) {
-        Database::instance().addFavorite(ChannelId(channelId));
-    } else {
-        Database::instance().removeFavorite(ChannelId(channelId));
-    }
+    const ChannelId id(channelId);
+    DatabaseWriter::instance().write(this, [id, favorite](Database &database) {
+        if (favorite) {
+            database.addFavorite(id);
+        } else {
+            database.removeFavorite(id);
+        }
+    });
 }
 
 void ChannelsModel::move(int from, int to)
@@ -136,5 +140,7 @@ void ChannelsModel::save()
     std::transform(m_channels.begin(), m_channels.end(), channelIds.begin(), [](const Channel *channel) {
         return ChannelId(channel->id());
     });
-    Database::instance().sortFavorites(channelIds);
+    DatabaseWriter::instance().write(this, [channelIds](Database &database) {
+        database.sortFavorites(channelIds);
+    });
 }
@@ -13,104 +13,219 @@
 #include <QStandardPaths>
 #include <QUrl>
 
+#include <utility>
+
+namespace
+{
+// PRAGMA user_version, see Database::migrate()
+const int schemaVersion = 4;
+}
+
 #define TRUE_OR_RETURN(x)                                                                                                                                      \
     if (!x)                                                                                                                                                    \
         return false;
 
-Database::Database()
+Database::Database(const QString &connectionName)
 {
-    QSqlDatabase db = QSqlDatabase::addDatabase(QStringLiteral("QSQLITE"));
+    m_db = QSqlDatabase::addDatabase(QStringLiteral("QSQLITE"), connectionName);
     const QString databasePath = QStandardPaths::writableLocation(QStandardPaths::AppDataLocation);
     QDir(databasePath).mkpath(databasePath);
-    db.setDatabaseName(databasePath + QStringLiteral("/database.db3"));
-    if (!db.open()) {
-        qCritical() << "Failed to open database";
+    m_db.setDatabaseName(databasePath + QStringLiteral("/database.db3"));
+    // wait for a write of the other connection instead of failing (ms)
+    m_db.setConnectOptions(QStringLiteral("QSQLITE_BUSY_TIMEOUT=5000"));
+    if (!m_db.open()) {
+        qCritical() << "Failed to open database" << connectionName;
     }
 
-    // drop DB if it doesn't use the correct fetcher
-    if (m_settings.fetcher() != fetcher()) {
-        if (!dropTables()) {
-            qCritical() << "Failed to drop database";
+    const bool isDefaultConnection = connectionName == QLatin1String(QSqlDatabase::defaultConnection);
+    if (isDefaultConnection) {
+        // drop DB if it doesn't use the correct fetcher
+        if (m_settings.fetcher() != fetcher()) {
+            if (!dropTables()) {
+                qCritical() << "Failed to drop database";
+            }
         }
-    }
 
-    if (!createTables()) {
-        qCritical() << "Failed to create database";
+        if (!migrate()) {
+            qCritical() << "Failed to create database";
+        }
     }
 
-    cleanup();
+    // e.g. categories are removed with their program
+    execute(QStringLiteral("PRAGMA foreign_keys = ON;"));
+
+    // old programs are removed by DatabaseWriter (in the background)
+    if (isDefaultConnection) {
+        loadCategories();
+    }
 
     // speed up database (especially for slow persistent memory like on the PinePhone)
+    // no exclusive locking: the GUI thread reads while the writer thread writes (WAL)
     execute(QStringLiteral("PRAGMA synchronous = OFF;"));
     execute(QStringLiteral("PRAGMA journal_mode = WAL;")); // TODO: or MEMORY?
     execute(QStringLiteral("PRAGMA temp_store = MEMORY;"));
-    execute(QStringLiteral("PRAGMA locking_mode = EXCLUSIVE;"));
 
     // prepare queries once (faster)
-    m_addGroupQuery.reset(new QSqlQuery(db));
+    m_addGroupQuery.reset(new QSqlQuery(m_db));
     bool success = m_addGroupQuery->prepare(QStringLiteral("INSERT OR IGNORE INTO \"Groups\" VALUES (:id, :name, :url);"));
-    m_groupCountQuery.reset(new QSqlQuery(db));
+    m_groupCountQuery.reset(new QSqlQuery(m_db));
     success &= m_groupCountQuery->prepare(QStringLiteral("SELECT COUNT() FROM \"Groups\";"));
-    m_groupExistsQuery.reset(new QSqlQuery(db));
+    m_groupExistsQuery.reset(new QSqlQuery(m_db));
     success &= m_groupExistsQuery->prepare(QStringLiteral("SELECT COUNT () FROM \"Groups\" WHERE id=:id;"));
-    m_groupsQuery.reset(new QSqlQuery(db));
+    m_groupsQuery.reset(new QSqlQuery(m_db));
     success &= m_groupsQuery->prepare(QStringLiteral("SELECT * FROM \"Groups\" ORDER BY name COLLATE NOCASE;"));
-    m_groupsPerChannelQuery.reset(new QSqlQuery(db));
+    m_groupsPerChannelQuery.reset(new QSqlQuery(m_db));
     success &= m_groupsPerChannelQuery->prepare(
         QStringLiteral("SELECT * FROM \"Groups\" WHERE id=(SELECT \"group\" from GroupChannels WHERE channel=:channel) ORDER BY name COLLATE NOCASE;"));
 
-    m_addGroupChannelQuery.reset(new QSqlQuery(db));
+    m_addGroupChannelQuery.reset(new QSqlQuery(m_db));
     success &= m_addGroupChannelQuery->prepare(QStringLiteral("INSERT OR IGNORE INTO GroupChannels VALUES (:id, :group, :channel);"));
 
-    m_addFavoriteQuery.reset(new QSqlQuery(db));
+    m_addFavoriteQuery.reset(new QSqlQuery(m_db));
     success &= m_addFavoriteQuery->prepare(QStringLiteral("INSERT INTO Favorites VALUES ((SELECT COUNT() FROM Favorites) + 1, :channel);"));
-    m_addChannelQuery.reset(new QSqlQuery(db));
+    m_addChannelQuery.reset(new QSqlQuery(m_db));
     success &= m_addChannelQuery->prepare(QStringLiteral("INSERT OR IGNORE INTO Channels VALUES (:id, :name, :url, :image);"));
-    m_channelCountQuery.reset(new QSqlQuery(db));
+    m_channelCountQuery.reset(new QSqlQuery(m_db));
     success &= m_channelCountQuery->prepare(QStringLiteral("SELECT COUNT() FROM Channels;"));
-    m_channelExistsQuery.reset(new QSqlQuery(db));
+    m_channelExistsQuery.reset(new QSqlQuery(m_db));
     success &= m_channelExistsQuery->prepare(QStringLiteral("SELECT COUNT () FROM Channels WHERE id=:id;"));
-    m_channelsQuery.reset(new QSqlQuery(db));
+    m_channelsQuery.reset(new QSqlQuery(m_db));
     success &= m_channelsQuery->prepare(QStringLiteral("SELECT * FROM Channels ORDER BY name COLLATE NOCASE;"));
-    m_channelQuery.reset(new QSqlQuery(db));
+    m_channelQuery.reset(new QSqlQuery(m_db));
     success &= m_channelQuery->prepare(QStringLiteral("SELECT * FROM Channels WHERE id=:channelId;"));
 
-    m_clearFavoritesQuery.reset(new QSqlQuery(db));
+    m_clearFavoritesQuery.reset(new QSqlQuery(m_db));
     success &= m_clearFavoritesQuery->prepare(QStringLiteral("DELETE FROM Favorites;"));
-    m_favoriteCountQuery.reset(new QSqlQuery(db));
+    m_favoriteCountQuery.reset(new QSqlQuery(m_db));
     success &= m_favoriteCountQuery->prepare(QStringLiteral("SELECT COUNT() FROM Favorites;"));
-    m_favoritesQuery.reset(new QSqlQuery(db));
+    m_favoritesQuery.reset(new QSqlQuery(m_db));
     success &= m_favoritesQuery->prepare(QStringLiteral("SELECT channel FROM Favorites ORDER BY id;"));
-    m_isFavoriteQuery.reset(new QSqlQuery(db));
+    m_isFavoriteQuery.reset(new QSqlQuery(m_db));
     success &= m_isFavoriteQuery->prepare(QStringLiteral("SELECT COUNT() FROM Favorites WHERE channel=:channel"));
 
-    m_addProgramQuery.reset(new QSqlQuery(db));
+    m_addCategoryQuery.reset(new QSqlQuery(m_db));
+    success &= m_addCategoryQuery->prepare(QStringLiteral("INSERT OR REPLACE INTO Categories VALUES (:id, :name);"));
+
+    m_addProgramQuery.reset(new QSqlQuery(m_db));
     success &= m_addProgramQuery->prepare(
-        QStringLiteral("INSERT OR IGNORE INTO Programs VALUES (:id, :url, :channel, :start, :stop, :title, :subtitle, :description, :descriptionFetched);"));
-    m_updateProgramDescriptionQuery.reset(new QSqlQuery(db));
+        QStringLiteral("INSERT OR IGNORE INTO Programs (id, url, channel, start, stop, title, subtitle, description, descriptionFetched, categories) VALUES "
+                       "(:id, :url, :channel, :start, :stop, :title, :subtitle, :description, :descriptionFetched, :categories);"));
+    // keeps the key of an existing program
+    m_updateProgramQuery.reset(new QSqlQuery(m_db));
+    success &= m_updateProgramQuery->prepare(
+        QStringLiteral("INSERT INTO Programs (id, url, channel, start, stop, title, subtitle, description, descriptionFetched, categories) VALUES (:id, :url, "
+                       ":channel, :start, :stop, :title, :subtitle, :description, :descriptionFetched, :categories) ON CONFLICT (id) DO UPDATE SET "
+                       "url=excluded.url, channel=excluded.channel, start=excluded.start, stop=excluded.stop, title=excluded.title, "
+                       "subtitle=excluded.subtitle, description=excluded.description, descriptionFetched=excluded.descriptionFetched, "
+                       "categories=excluded.categories;"));
+    m_updateProgramDescriptionQuery.reset(new QSqlQuery(m_db));
     success &= m_updateProgramDescriptionQuery->prepare(QStringLiteral("UPDATE Programs SET description=:description, descriptionFetched=TRUE WHERE id=:id;"));
-    m_programExistsQuery.reset(new QSqlQuery(db));
+    m_programTimeQuery.reset(new QSqlQuery(m_db));
+    success &= m_programTimeQuery->prepare(QStringLiteral("SELECT channel, start, stop FROM Programs WHERE id=:id;"));
+    m_removeProgramQuery.reset(new QSqlQuery(m_db));
+    success &= m_removeProgramQuery->prepare(QStringLiteral("DELETE FROM Programs WHERE id=:id;"));
+    m_programExistsQuery.reset(new QSqlQuery(m_db));
     success &= m_programExistsQuery->prepare(QStringLiteral("SELECT COUNT () FROM Programs WHERE channel=:channel AND stop>=:lastTime;"));
-    m_programCountQuery.reset(new QSqlQuery(db));
+    m_descriptionFetchedQuery.reset(new QSqlQuery(m_db));
+    success &= m_descriptionFetchedQuery->prepare(QStringLiteral("SELECT descriptionFetched FROM Programs WHERE id=:id;"));
+    m_programCountQuery.reset(new QSqlQuery(m_db));
     success &= m_programCountQuery->prepare(QStringLiteral("SELECT COUNT() FROM Programs WHERE channel=:channel;"));
-    m_programsQuery.reset(new QSqlQuery(db));
-    success &= m_programsQuery->prepare(QStringLiteral("SELECT * FROM Programs ORDER BY channel, start;"));
-    m_programsPerChannelQuery.reset(new QSqlQuery(db));
+    m_programsPerChannelQuery.reset(new QSqlQuery(m_db));
+    m_programsPerChannelQuery->setForwardOnly(true);
     success &= m_programsPerChannelQuery->prepare(QStringLiteral("SELECT * FROM Programs WHERE channel=:channel ORDER BY start;"));
-
-    m_addProgramCategoryQuery.reset(new QSqlQuery(db));
-    success &= m_addProgramCategoryQuery->prepare(QStringLiteral("INSERT OR IGNORE INTO ProgramCategories VALUES (:program, :category);"));
-    m_programCategoriesQuery.reset(new QSqlQuery(db));
-    success &= m_programCategoriesQuery->prepare(QStringLiteral("SELECT category FROM ProgramCategories WHERE program=:program;"));
+    // start is bounded by the index (channel, start, stop)
+    m_programsInWindowQuery.reset(new QSqlQuery(m_db));
+    m_programsInWindowQuery->setForwardOnly(true);
+    success &= m_programsInWindowQuery->prepare(QStringLiteral("SELECT * FROM Programs WHERE channel=:channel AND start<=:to AND stop>:from ORDER BY start;"));
+    m_programsWithoutDescriptionQuery.reset(new QSqlQuery(m_db));
+    success &= m_programsWithoutDescriptionQuery->prepare(
+        QStringLiteral("SELECT id, url, channel, start, stop FROM Programs WHERE descriptionFetched=0 AND stop>=:from AND start<=:to AND channel IN (SELECT "
+                       "channel FROM Favorites) ORDER BY start;"));
+
+    m_addProgramCategoryQuery.reset(new QSqlQuery(m_db));
+    success &= m_addProgramCategoryQuery->prepare(QStringLiteral("INSERT OR IGNORE INTO ProgramCategories VALUES ((SELECT key FROM Programs WHERE id=:program), :category);"));
+    // categories (beyond the mask) of all programs at once (instead of one query per program)
+    m_programCategoriesPerChannelQuery.reset(new QSqlQuery(m_db));
+    m_programCategoriesPerChannelQuery->setForwardOnly(true);
+    success &= m_programCategoriesPerChannelQuery->prepare(
+        QStringLiteral("SELECT ProgramCategories.program, ProgramCategories.category FROM Programs JOIN ProgramCategories ON "
+                       "ProgramCategories.program=Programs.key WHERE Programs.channel=:channel;"));
+    m_programCategoriesInWindowQuery.reset(new QSqlQuery(m_db));
+    m_programCategoriesInWindowQuery->setForwardOnly(true);
+    success &= m_programCategoriesInWindowQuery->prepare(
+        QStringLiteral("SELECT ProgramCategories.program, ProgramCategories.category FROM Programs JOIN ProgramCategories ON "
+                       "ProgramCategories.program=Programs.key WHERE Programs.channel=:channel AND Programs.start<=:to AND Programs.stop>:from;"));
+    m_removeProgramCategoriesQuery.reset(new QSqlQuery(m_db));
+    success &= m_removeProgramCategoriesQuery->prepare(QStringLiteral("DELETE FROM ProgramCategories WHERE program=(SELECT key FROM Programs WHERE id=:program);"));
+
+    m_importFingerprintQuery.reset(new QSqlQuery(m_db));
+    success &= m_importFingerprintQuery->prepare(QStringLiteral("SELECT fingerprint FROM ImportFingerprints WHERE channel=:channel;"));
+    m_setImportFingerprintQuery.reset(new QSqlQuery(m_db));
+    success &= m_setImportFingerprintQuery->prepare(QStringLiteral("INSERT OR REPLACE INTO ImportFingerprints VALUES (:channel, :fingerprint);"));
+
+    m_addFetchedDayQuery.reset(new QSqlQuery(m_db));
+    success &= m_addFetchedDayQuery->prepare(QStringLiteral("INSERT OR IGNORE INTO FetchedDays VALUES (:channel, :day);"));
+    m_fetchedDaysQuery.reset(new QSqlQuery(m_db));
+    m_fetchedDaysQuery->setForwardOnly(true);
+    success &= m_fetchedDaysQuery->prepare(QStringLiteral("SELECT day FROM FetchedDays WHERE channel=:channel AND day>=:first AND day<=:last ORDER BY day;"));
 
     if (!success) {
         qCritical() << "Failed to prepare database queries";
     }
 
-    connect(&m_settings, &TellySkoutSettings::fetcherChanged, this, [this]() {
-        dropTables();
-        createTables();
-    });
+    if (isDefaultConnection) {
+        connect(&m_settings, &TellySkoutSettings::fetcherChanged, this, [this]() {
+            dropTables();
+            migrate();
+            Categories::instance().markUnstored();
+        });
+    }
+}
+
+bool Database::migrate()
+{
+    const int current = version();
+    if (current < 0 || current > schemaVersion) {
+        qCritical() << "Unsupported database version" << current;
+        return false;
+    }
+
+    // tables are replaced during the migrations (cannot be changed within a transaction)
+    TRUE_OR_RETURN(execute(QStringLiteral("PRAGMA foreign_keys = OFF;")));
+
+    bool success = true;
+    for (int version = current + 1; success && version <= schemaVersion; ++version) {
+        qDebug() << "Migrate database to version" << version;
+
+        // each migration is applied completely or not at all
+        m_db.transaction();
+        success = migrate(version) && execute(QStringLiteral("PRAGMA user_version = ") + QString::number(version) + ";");
+        if (success) {
+            m_db.commit();
+        } else {
+            qCritical() << "Failed to migrate database to version" << version;
+            m_db.rollback();
+        }
+    }
+
+    execute(QStringLiteral("PRAGMA foreign_keys = ON;"));
+    return success;
+}
+
+bool Database::migrate(int version)
+{
+    switch (version) {
+    case 1:
+        return createTables();
+    case 2:
+        return addProgramKeys();
+    case 3:
+        return addCategoryIds();
+    case 4:
+        return addFetchedDays();
+    default:
+        return false;
+    }
 }
 
 bool Database::createTables()
@@ -129,7 +244,83 @@ bool Database::createTables()
     TRUE_OR_RETURN(execute(QStringLiteral("CREATE TABLE IF NOT EXISTS ProgramCategories (program TEXT, category TEXT);")));
     TRUE_OR_RETURN(execute(QStringLiteral("CREATE TABLE IF NOT EXISTS Favorites (id INTEGER UNIQUE, channel TEXT UNIQUE);")));
 
-    TRUE_OR_RETURN(execute(QStringLiteral("PRAGMA user_version = 1;")));
+    return true;
+}
+
+bool Database::addProgramKeys()
+{
+    // integer keys for programs (categories refer to them instead of the text IDs)
+    TRUE_OR_RETURN(execute(
+        QStringLiteral("CREATE TABLE ProgramsNew (key INTEGER PRIMARY KEY, id TEXT UNIQUE NOT NULL, url TEXT, channel TEXT, start INTEGER, stop INTEGER, "
+                       "title TEXT, subtitle TEXT, description TEXT, descriptionFetched INTEGER);")));
+    TRUE_OR_RETURN(execute(
+        QStringLiteral("INSERT OR IGNORE INTO ProgramsNew (id, url, channel, start, stop, title, subtitle, description, descriptionFetched) SELECT id, url, "
+                       "channel, start, stop, title, subtitle, description, descriptionFetched FROM Programs WHERE id IS NOT NULL;")));
+    TRUE_OR_RETURN(execute(
+        QStringLiteral("CREATE TABLE ProgramCategoriesNew (program INTEGER NOT NULL REFERENCES Programs(key) ON DELETE CASCADE, category TEXT, UNIQUE "
+                       "(program, category));")));
+    // drops the categories of removed programs
+    TRUE_OR_RETURN(execute(
+        QStringLiteral("INSERT OR IGNORE INTO ProgramCategoriesNew SELECT ProgramsNew.key, ProgramCategories.category FROM ProgramCategories JOIN "
+                       "ProgramsNew ON ProgramsNew.id=ProgramCategories.program;")));
+    TRUE_OR_RETURN(execute(QStringLiteral("DROP TABLE ProgramCategories;")));
+    TRUE_OR_RETURN(execute(QStringLiteral("DROP TABLE Programs;")));
+    TRUE_OR_RETURN(execute(QStringLiteral("ALTER TABLE ProgramsNew RENAME TO Programs;")));
+    TRUE_OR_RETURN(execute(QStringLiteral("ALTER TABLE ProgramCategoriesNew RENAME TO ProgramCategories;")));
+
+    // programs per channel ordered by start, coverage (includes stop, i.e. without table lookup)
+    TRUE_OR_RETURN(execute(QStringLiteral("CREATE INDEX ProgramsByChannel ON Programs (channel, start, stop);")));
+    // groups per channel
+    TRUE_OR_RETURN(execute(QStringLiteral("CREATE INDEX GroupChannelsByChannel ON GroupChannels (channel);")));
+
+    // missing in databases which have been created before the migrations
+    TRUE_OR_RETURN(execute(QStringLiteral("CREATE TABLE IF NOT EXISTS ImportFingerprints (channel TEXT UNIQUE, fingerprint TEXT);")));
+
+    return true;
+}
+
+bool Database::addCategoryIds()
+{
+    // category names once in a dictionary, programs refer to them by ID
+    TRUE_OR_RETURN(execute(QStringLiteral("CREATE TABLE Categories (id INTEGER PRIMARY KEY, name TEXT UNIQUE NOT NULL);")));
+
+    // most frequent categories first (i.e. in the mask)
+    QSqlQuery names(m_db);
+    names.setForwardOnly(true);
+    TRUE_OR_RETURN(names.prepare(QStringLiteral("SELECT category FROM ProgramCategories WHERE category IS NOT NULL GROUP BY category ORDER BY COUNT() DESC;")));
+    TRUE_OR_RETURN(execute(names));
+    QSqlQuery addCategory(m_db);
+    TRUE_OR_RETURN(addCategory.prepare(QStringLiteral("INSERT INTO Categories VALUES (:id, :name);")));
+    for (CategoryId id = 0; names.next(); ++id) {
+        addCategory.bindValue(QStringLiteral(":id"), id);
+        addCategory.bindValue(QStringLiteral(":name"), names.value(0).toString());
+        TRUE_OR_RETURN(execute(addCategory));
+    }
+
+    // IDs < 64 as bits of the program, the others (rare) in ProgramCategories
+    TRUE_OR_RETURN(execute(QStringLiteral("ALTER TABLE Programs ADD COLUMN categories INTEGER NOT NULL DEFAULT 0;")));
+    TRUE_OR_RETURN(execute(
+        QStringLiteral("UPDATE Programs SET categories=COALESCE((SELECT SUM(1 << Categories.id) FROM ProgramCategories JOIN Categories ON "
+                       "Categories.name=ProgramCategories.category WHERE ProgramCategories.program=Programs.key AND Categories.id < ")
+        + QString::number(CategorySet::maskSize) + "), 0);"));
+    TRUE_OR_RETURN(execute(
+        QStringLiteral("CREATE TABLE ProgramCategoriesNew (program INTEGER NOT NULL REFERENCES Programs(key) ON DELETE CASCADE, category INTEGER NOT NULL, "
+                       "PRIMARY KEY (program, category)) WITHOUT ROWID;")));
+    TRUE_OR_RETURN(execute(
+        QStringLiteral("INSERT OR IGNORE INTO ProgramCategoriesNew SELECT ProgramCategories.program, Categories.id FROM ProgramCategories JOIN Categories ON "
+                       "Categories.name=ProgramCategories.category WHERE Categories.id >= ")
+        + QString::number(CategorySet::maskSize) + ";"));
+    TRUE_OR_RETURN(execute(QStringLiteral("DROP TABLE ProgramCategories;")));
+    TRUE_OR_RETURN(execute(QStringLiteral("ALTER TABLE ProgramCategoriesNew RENAME TO ProgramCategories;")));
+
+    return true;
+}
+
+bool Database::addFetchedDays()
+{
+    // days of a channel whose programs have been fetched completely (Julian day)
+    TRUE_OR_RETURN(execute(QStringLiteral("CREATE TABLE FetchedDays (channel TEXT NOT NULL, day INTEGER NOT NULL, PRIMARY KEY (channel, day)) WITHOUT ROWID;")));
+
     return true;
 }
 
@@ -140,16 +331,41 @@ bool Database::dropTables()
     TRUE_OR_RETURN(execute(QStringLiteral("DROP TABLE IF EXISTS \"Groups\";")));
     TRUE_OR_RETURN(execute(QStringLiteral("DROP TABLE IF EXISTS Channels;")));
     TRUE_OR_RETURN(execute(QStringLiteral("DROP TABLE IF EXISTS GroupChannels;")));
-    TRUE_OR_RETURN(execute(QStringLiteral("DROP TABLE IF EXISTS Programs;")));
     TRUE_OR_RETURN(execute(QStringLiteral("DROP TABLE IF EXISTS ProgramCategories;")));
+    TRUE_OR_RETURN(execute(QStringLiteral("DROP TABLE IF EXISTS Categories;")));
+    TRUE_OR_RETURN(execute(QStringLiteral("DROP TABLE IF EXISTS Programs;")));
     TRUE_OR_RETURN(execute(QStringLiteral("DROP TABLE IF EXISTS Favorites;")));
+    TRUE_OR_RETURN(execute(QStringLiteral("DROP TABLE IF EXISTS ImportFingerprints;")));
+    TRUE_OR_RETURN(execute(QStringLiteral("DROP TABLE IF EXISTS FetchedDays;")));
+    TRUE_OR_RETURN(execute(QStringLiteral("PRAGMA user_version = 0;")));
 
     return true;
 }
 
+bool Database::transaction() const
+{
+    // nested: only the outermost transaction is executed (e.g. several writes of DatabaseWriter in one transaction)
+    if (m_transactionDepth++ > 0) {
+        return true;
+    }
+    return m_db.transaction();
+}
+
+bool Database::commit() const
+{
+    if (m_transactionDepth == 0) {
+        qWarning() << "Commit without transaction";
+        return false;
+    }
+    if (--m_transactionDepth > 0) {
+        return true;
+    }
+    return m_db.commit();
+}
+
 bool Database::execute(const QString &query) const
 {
-    QSqlQuery q;
+    QSqlQuery q(m_db);
     if (q.prepare(query)) {
         return execute(q);
     } else {
@@ -173,7 +389,7 @@ int Database::version() const
 {
     const int error = -1;
 
-    QSqlQuery query;
+    QSqlQuery query(m_db);
     if (!query.prepare(QStringLiteral("PRAGMA user_version;"))) {
         qCritical() << "Failed to prepare query for user_version";
         return error;
@@ -199,7 +415,7 @@ int Database::fetcher() const
 {
     const int error = -1;
 
-    QSqlQuery query;
+    QSqlQuery query(m_db);
     if (!query.prepare(QStringLiteral("SELECT * FROM Fetcher;"))) {
         qCritical() << "Failed to prepare query for fetcher";
         return error;
@@ -229,13 +445,21 @@ void Database::cleanup()
     dateTime = dateTime.addDays(-static_cast<qint64>(days));
     const qint64 sinceEpoch = dateTime.toSecsSinceEpoch();
 
-    QSqlQuery query;
+    QSqlQuery query(m_db);
     if (!query.prepare(QStringLiteral("DELETE FROM Programs WHERE stop < :sinceEpoch;"))) {
         qCritical() << "Failed to prepare cleanup query";
         return;
     }
     query.bindValue(QStringLiteral(":sinceEpoch"), sinceEpoch);
     execute(query);
+
+    QSqlQuery fetchedDaysQuery(m_db);
+    if (!fetchedDaysQuery.prepare(QStringLiteral("DELETE FROM FetchedDays WHERE day < :day;"))) {
+        qCritical() << "Failed to prepare cleanup query";
+        return;
+    }
+    fetchedDaysQuery.bindValue(QStringLiteral(":day"), dateTime.date().toJulianDay());
+    execute(fetchedDaysQuery);
 }
 
 void Database::addGroup(const GroupId &id, const QString &name, const QString &url)
@@ -328,6 +552,15 @@ void Database::addChannel(const ChannelData &data, const GroupId &group)
     }
 }
 
+void Database::addChannels(const QVector<ChannelData> &channels, const GroupId &group)
+{
+    transaction();
+    for (const auto &data : channels) {
+        addChannel(data, group);
+    }
+    commit();
+}
+
 size_t Database::channelCount() const
 {
     execute(*m_channelCountQuery);
@@ -354,11 +587,11 @@ QVector<ChannelData> Database::channels(bool onlyFavorites) const
     if (onlyFavorites) {
         const QVector<ChannelId> &favoriteIds = favorites();
 
-        QSqlDatabase::database().transaction();
+        transaction();
         for (int i = 0; i < favoriteIds.size(); ++i) {
             channels.append(channel(favoriteIds.at(i)));
         }
-        QSqlDatabase::database().commit();
+        commit();
     } else {
         execute(*m_channelsQuery);
         while (m_channelsQuery->next()) {
@@ -406,27 +639,27 @@ void Database::removeFavorite(const ChannelId &channelId)
     QVector<ChannelId> favoriteChannelIds = favorites();
     favoriteChannelIds.removeAll(channelId);
 
-    QSqlDatabase::database().transaction();
+    transaction();
     execute(*m_clearFavoritesQuery);
     for (const auto &id : qAsConst(favoriteChannelIds)) {
         m_addFavoriteQuery->bindValue(QStringLiteral(":channel"), id.value());
         execute(*m_addFavoriteQuery);
     }
-    QSqlDatabase::database().commit();
+    commit();
 
     Q_EMIT channelDetailsUpdated(channelId, false);
 }
 
 void Database::sortFavorites(const QVector<ChannelId> &newOrder)
 {
-    QSqlDatabase::database().transaction();
+    transaction();
     // do not use clearFavorites() and addFavorite() to avoid unneccesary signals (and therefore updates)
     execute(*m_clearFavoritesQuery);
     for (const auto &channelId : newOrder) {
         m_addFavoriteQuery->bindValue(QStringLiteral(":channel"), channelId.value());
         execute(*m_addFavoriteQuery);
     }
-    QSqlDatabase::database().commit();
+    commit();
 
     Q_EMIT favoritesUpdated();
 }
@@ -474,21 +707,35 @@ bool Database::isFavorite(const ChannelId &channelId) const
 
 void Database::addProgram(const ProgramData &data)
 {
-    m_addProgramQuery->bindValue(QStringLiteral(":id"), data.m_id.value());
-    m_addProgramQuery->bindValue(QStringLiteral(":url"), data.m_url);
-    m_addProgramQuery->bindValue(QStringLiteral(":channel"), data.m_channelId.value());
-    m_addProgramQuery->bindValue(QStringLiteral(":start"), data.m_startTime.toSecsSinceEpoch());
-    m_addProgramQuery->bindValue(QStringLiteral(":stop"), data.m_stopTime.toSecsSinceEpoch());
-    m_addProgramQuery->bindValue(QStringLiteral(":title"), data.m_title);
-    m_addProgramQuery->bindValue(QStringLiteral(":subtitle"), data.m_subtitle);
-    m_addProgramQuery->bindValue(QStringLiteral(":description"), data.m_description);
-    m_addProgramQuery->bindValue(QStringLiteral(":descriptionFetched"), data.m_descriptionFetched);
+    storeCategories();
 
+    bindProgram(*m_addProgramQuery, data);
     execute(*m_addProgramQuery);
+    addProgramChange(data.m_channelId, data.m_startTime.toSecsSinceEpoch(), data.m_stopTime.toSecsSinceEpoch());
+
+    addProgramCategories(data);
+}
+
+void Database::bindProgram(QSqlQuery &query, const ProgramData &data)
+{
+    query.bindValue(QStringLiteral(":id"), data.m_id.value());
+    query.bindValue(QStringLiteral(":url"), data.m_url);
+    query.bindValue(QStringLiteral(":channel"), data.m_channelId.value());
+    query.bindValue(QStringLiteral(":start"), data.m_startTime.toSecsSinceEpoch());
+    query.bindValue(QStringLiteral(":stop"), data.m_stopTime.toSecsSinceEpoch());
+    query.bindValue(QStringLiteral(":title"), data.m_title);
+    query.bindValue(QStringLiteral(":subtitle"), data.m_subtitle);
+    query.bindValue(QStringLiteral(":description"), data.m_description);
+    query.bindValue(QStringLiteral(":descriptionFetched"), data.m_descriptionFetched);
+    // SQLite integers are signed
+    query.bindValue(QStringLiteral(":categories"), static_cast<qint64>(data.m_categories.mask()));
+}
 
+void Database::addProgramCategories(const ProgramData &data)
+{
     m_addProgramCategoryQuery->bindValue(QStringLiteral(":program"), data.m_id.value());
 
-    const QVector<QString> &categories = data.m_categories;
+    const QVector<CategoryId> &categories = data.m_categories.overflow();
     for (int i = 0; i < categories.size(); ++i) {
         m_addProgramCategoryQuery->bindValue(QStringLiteral(":category"), categories.at(i));
         execute(*m_addProgramCategoryQuery);
@@ -501,18 +748,83 @@ void Database::updateProgramDescription(const ProgramId &id, const QString &desc
     m_updateProgramDescriptionQuery->bindValue(QStringLiteral(":description"), description);
 
     execute(*m_updateProgramDescriptionQuery);
+    addProgramChange(id);
 }
 
 void Database::addPrograms(const QVector<ProgramData> &programs)
 {
-    QSqlDatabase::database().transaction();
+    transaction();
 
     for (int i = 0; i < programs.length(); i++) {
         const ProgramData &data = programs.at(i);
         addProgram(data);
     }
 
-    QSqlDatabase::database().commit();
+    commit();
+}
+
+void Database::updatePrograms(const QVector<ProgramData> &programs)
+{
+    transaction();
+
+    storeCategories();
+
+    for (int i = 0; i < programs.length(); i++) {
+        const ProgramData &data = programs.at(i);
+
+        addProgramChange(data.m_id); // previous time (if the program exists already)
+        bindProgram(*m_updateProgramQuery, data);
+        execute(*m_updateProgramQuery);
+        addProgramChange(data.m_channelId, data.m_startTime.toSecsSinceEpoch(), data.m_stopTime.toSecsSinceEpoch());
+
+        m_removeProgramCategoriesQuery->bindValue(QStringLiteral(":program"), data.m_id.value());
+        execute(*m_removeProgramCategoriesQuery);
+        addProgramCategories(data);
+    }
+
+    commit();
+}
+
+void Database::removePrograms(const QVector<ProgramId> &ids)
+{
+    transaction();
+
+    for (int i = 0; i < ids.length(); i++) {
+        addProgramChange(ids.at(i));
+        // the categories are removed as well (foreign key)
+        m_removeProgramQuery->bindValue(QStringLiteral(":id"), ids.at(i).value());
+        execute(*m_removeProgramQuery);
+    }
+
+    commit();
+}
+
+ProgramChanges Database::takeProgramChanges()
+{
+    ProgramChanges changes;
+    std::swap(changes, m_programChanges);
+    return changes;
+}
+
+void Database::addProgramChange(const ChannelId &channelId, qint64 start, qint64 stop)
+{
+    const auto it = m_programChanges.find(channelId);
+    if (it == m_programChanges.end()) {
+        m_programChanges.insert(channelId, qMakePair(start, stop));
+    } else {
+        it->first = qMin(it->first, start);
+        it->second = qMax(it->second, stop);
+    }
+}
+
+void Database::addProgramChange(const ProgramId &id)
+{
+    m_programTimeQuery->bindValue(QStringLiteral(":id"), id.value());
+    execute(*m_programTimeQuery);
+    if (m_programTimeQuery->next()) {
+        addProgramChange(ChannelId(m_programTimeQuery->value(0).toString()), m_programTimeQuery->value(1).toLongLong(), m_programTimeQuery->value(2).toLongLong());
+    }
+    m_programTimeQuery->finish();
 }
 
 bool Database::programExists(const ChannelId &channelId, qint64 lastTime) const
@@ -525,6 +837,16 @@ bool Database::programExists(const ChannelId &channelId, qint64 lastTime) const
     return m_programExistsQuery->value(0).toInt() > 0;
 }
 
+bool Database::descriptionFetched(const ProgramId &id) const
+{
+    m_descriptionFetchedQuery->bindValue(QStringLiteral(":id"), id.value());
+    execute(*m_descriptionFetchedQuery);
+    if (!m_descriptionFetchedQuery->next()) {
+        return false;
+    }
+    return m_descriptionFetchedQuery->value(0).toBool();
+}
+
 size_t Database::programCount(const ChannelId &channelId) const
 {
     m_programCountQuery->bindValue(QStringLiteral(":channel"), channelId.value());
@@ -536,69 +858,150 @@ size_t Database::programCount(const ChannelId &channelId) const
     return m_programCountQuery->value(0).toInt();
 }
 
-QMap<ChannelId, QVector<ProgramData>> Database::programs() const
+QVector<ProgramData> Database::programs(const ChannelId &channelId) const
 {
-    QMap<ChannelId, QVector<ProgramData>> programs;
+    m_programCategoriesPerChannelQuery->bindValue(QStringLiteral(":channel"), channelId.value());
+    execute(*m_programCategoriesPerChannelQuery);
+    const QHash<qint64, QVector<CategoryId>> categories = readCategories(*m_programCategoriesPerChannelQuery);
 
-    execute(*m_programsQuery);
+    m_programsPerChannelQuery->bindValue(QStringLiteral(":channel"), channelId.value());
+    execute(*m_programsPerChannelQuery);
+    return readPrograms(*m_programsPerChannelQuery, categories);
+}
 
-    while (m_programsQuery->next()) {
-        const ChannelId channelId = ChannelId(m_programsQuery->value(QStringLiteral("channel")).toString());
-        if (!programs.contains(channelId)) {
-            programs.insert(channelId, QVector<ProgramData>());
-        }
+QVector<ProgramData> Database::programs(const ChannelId &channelId, qint64 from, qint64 to) const
+{
+    m_programCategoriesInWindowQuery->bindValue(QStringLiteral(":channel"), channelId.value());
+    m_programCategoriesInWindowQuery->bindValue(QStringLiteral(":from"), from);
+    m_programCategoriesInWindowQuery->bindValue(QStringLiteral(":to"), to);
+    execute(*m_programCategoriesInWindowQuery);
+    const QHash<qint64, QVector<CategoryId>> categories = readCategories(*m_programCategoriesInWindowQuery);
+
+    m_programsInWindowQuery->bindValue(QStringLiteral(":channel"), channelId.value());
+    m_programsInWindowQuery->bindValue(QStringLiteral(":from"), from);
+    m_programsInWindowQuery->bindValue(QStringLiteral(":to"), to);
+    execute(*m_programsInWindowQuery);
+    return readPrograms(*m_programsInWindowQuery, categories);
+}
 
+QVector<ProgramData> Database::readPrograms(QSqlQuery &query, const QHash<qint64, QVector<CategoryId>> &categories) const
+{
+    QVector<ProgramData> programs;
+    while (query.next()) {
         ProgramData data;
-        data.m_id = ProgramId(m_programsQuery->value(QStringLiteral("id")).toString());
-        data.m_url = m_programsQuery->value(QStringLiteral("url")).toString();
-        data.m_channelId = channelId;
-        data.m_startTime.setSecsSinceEpoch(m_programsQuery->value(QStringLiteral("start")).toInt());
-        data.m_stopTime.setSecsSinceEpoch(m_programsQuery->value(QStringLiteral("stop")).toInt());
-        data.m_title = m_programsQuery->value(QStringLiteral("title")).toString();
-        data.m_subtitle = m_programsQuery->value(QStringLiteral("subtitle")).toString();
-        data.m_description = m_programsQuery->value(QStringLiteral("description")).toString();
-        data.m_descriptionFetched = m_programsQuery->value(QStringLiteral("descriptionFetched")).toBool();
-
-        m_programCategoriesQuery->bindValue(QStringLiteral(":program"), data.m_id.value());
-        execute(*m_programCategoriesQuery);
-
-        while (m_programCategoriesQuery->next()) {
-            data.m_categories.push_back(m_programCategoriesQuery->value(QStringLiteral("category")).toString());
-        }
+        data.m_id = ProgramId(query.value(QStringLiteral("id")).toString());
+        data.m_url = query.value(QStringLiteral("url")).toString();
+        data.m_channelId = ChannelId(query.value(QStringLiteral("channel")).toString());
+        data.m_startTime.setSecsSinceEpoch(query.value(QStringLiteral("start")).toLongLong());
+        data.m_stopTime.setSecsSinceEpoch(query.value(QStringLiteral("stop")).toLongLong());
+        data.m_title = query.value(QStringLiteral("title")).toString();
+        data.m_subtitle = query.value(QStringLiteral("subtitle")).toString();
+        data.m_description = query.value(QStringLiteral("description")).toString();
+        data.m_descriptionFetched = query.value(QStringLiteral("descriptionFetched")).toBool();
+
+        data.m_categories = CategorySet(static_cast<quint64>(query.value(QStringLiteral("categories")).toLongLong()),
+                                        categories.value(query.value(QStringLiteral("key")).toLongLong()));
 
-        programs[channelId].push_back(data);
+        programs.push_back(data);
     }
-
     return programs;
 }
 
-QVector<ProgramData> Database::programs(const ChannelId &channelId) const
+QHash<qint64, QVector<CategoryId>> Database::readCategories(QSqlQuery &query) const
 {
-    QVector<ProgramData> programs;
+    QHash<qint64, QVector<CategoryId>> categories;
+    while (query.next()) {
+        categories[query.value(0).toLongLong()].push_back(query.value(1).toInt());
+    }
+    return categories;
+}
 
-    m_programsPerChannelQuery->bindValue(QStringLiteral(":channel"), channelId.value());
-    execute(*m_programsPerChannelQuery);
+void Database::loadCategories()
+{
+    QSqlQuery query(m_db);
+    query.setForwardOnly(true);
+    if (!query.prepare(QStringLiteral("SELECT id, name FROM Categories;"))) {
+        qCritical() << "Failed to prepare query for categories";
+        return;
+    }
+    execute(query);
 
-    while (m_programsPerChannelQuery->next()) {
-        ProgramData data;
-        data.m_id = ProgramId(m_programsPerChannelQuery->value(QStringLiteral("id")).toString());
-        data.m_url = m_programsPerChannelQuery->value(QStringLiteral("url")).toString();
-        data.m_channelId = ChannelId(m_programsPerChannelQuery->value(QStringLiteral("channel")).toString());
-        data.m_startTime.setSecsSinceEpoch(m_programsPerChannelQuery->value(QStringLiteral("start")).toInt());
-        data.m_stopTime.setSecsSinceEpoch(m_programsPerChannelQuery->value(QStringLiteral("stop")).toInt());
-        data.m_title = m_programsPerChannelQuery->value(QStringLiteral("title")).toString();
-        data.m_subtitle = m_programsPerChannelQuery->value(QStringLiteral("subtitle")).toString();
-        data.m_description = m_programsPerChannelQuery->value(QStringLiteral("description")).toString();
-        data.m_descriptionFetched = m_programsPerChannelQuery->value(QStringLiteral("descriptionFetched")).toBool();
-
-        m_programCategoriesQuery->bindValue(QStringLiteral(":program"), data.m_id.value());
-        execute(*m_programCategoriesQuery);
-
-        while (m_programCategoriesQuery->next()) {
-            data.m_categories.push_back(m_programCategoriesQuery->value(QStringLiteral("category")).toString());
+    QVector<QString> names;
+    while (query.next()) {
+        const int id = query.value(0).toInt();
+        if (id >= names.size()) {
+            names.resize(id + 1);
         }
+        names[id] = query.value(1).toString();
+    }
+    Categories::instance().load(names);
+}
+
+void Database::storeCategories()
+{
+    const auto categories = Categories::instance().takeUnstored();
+    for (const auto &category : categories) {
+        m_addCategoryQuery->bindValue(QStringLiteral(":id"), category.first);
+        m_addCategoryQuery->bindValue(QStringLiteral(":name"), category.second);
+        execute(*m_addCategoryQuery);
+    }
+}
 
+QVector<ProgramData> Database::programsWithoutDescription(qint64 from, qint64 to) const
+{
+    QVector<ProgramData> programs;
+
+    m_programsWithoutDescriptionQuery->bindValue(QStringLiteral(":from"), from);
+    m_programsWithoutDescriptionQuery->bindValue(QStringLiteral(":to"), to);
+    execute(*m_programsWithoutDescriptionQuery);
+
+    while (m_programsWithoutDescriptionQuery->next()) {
+        ProgramData data;
+        data.m_id = ProgramId(m_programsWithoutDescriptionQuery->value(QStringLiteral("id")).toString());
+        data.m_url = m_programsWithoutDescriptionQuery->value(QStringLiteral("url")).toString();
+        data.m_channelId = ChannelId(m_programsWithoutDescriptionQuery->value(QStringLiteral("channel")).toString());
+        data.m_startTime.setSecsSinceEpoch(m_programsWithoutDescriptionQuery->value(QStringLiteral("start")).toLongLong());
+        data.m_stopTime.setSecsSinceEpoch(m_programsWithoutDescriptionQuery->value(QStringLiteral("stop")).toLongLong());
+        data.m_descriptionFetched = false;
         programs.push_back(data);
     }
     return programs;
 }
+
+QString Database::importFingerprint(const ChannelId &channelId) const
+{
+    m_importFingerprintQuery->bindValue(QStringLiteral(":channel"), channelId.value());
+    execute(*m_importFingerprintQuery);
+    if (!m_importFingerprintQuery->next()) {
+        return QString();
+    }
+    return m_importFingerprintQuery->value(QStringLiteral("fingerprint")).toString();
+}
+
+void Database::setImportFingerprint(const ChannelId &channelId, const QString &fingerprint)
+{
+    m_setImportFingerprintQuery->bindValue(QStringLiteral(":channel"), channelId.value());
+    m_setImportFingerprintQuery->bindValue(QStringLiteral(":fingerprint"), fingerprint);
+    execute(*m_setImportFingerprintQuery);
+}
+
+void Database::addFetchedDay(const ChannelId &channelId, const QDate &day)
+{
+    m_addFetchedDayQuery->bindValue(QStringLiteral(":channel"), channelId.value());
+    m_addFetchedDayQuery->bindValue(QStringLiteral(":day"), day.toJulianDay());
+    execute(*m_addFetchedDayQuery);
+}
+
+QVector<QDate> Database::fetchedDays(const ChannelId &channelId, const QDate &first, const QDate &last) const
+{
+    m_fetchedDaysQuery->bindValue(QStringLiteral(":channel"), channelId.value());
+    m_fetchedDaysQuery->bindValue(QStringLiteral(":first"), first.toJulianDay());
+    m_fetchedDaysQuery->bindValue(QStringLiteral(":last"), last.toJulianDay());
+    execute(*m_fetchedDaysQuery);
+
+    QVector<QDate> days;
+    while (m_fetchedDaysQuery->next()) {
+        days.push_back(QDate::fromJulianDay(m_fetchedDaysQuery->value(0).toLongLong()));
+    }
+    return days;
+}
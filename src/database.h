@@ -6,12 +6,17 @@
 #include <QObject>
 
 #include "TellySkoutSettings.h"
+#include "categories.h"
 #include "channeldata.h"
 #include "groupdata.h"
 #include "programdata.h"
 #include "types.h"
 
+#include <QDate>
+#include <QHash>
 #include <QMap>
+#include <QPair>
+#include <QSqlDatabase>
 #include <QSqlQuery>
 #include <QString>
 #include <QVector>
@@ -20,6 +25,11 @@
 
 class QSqlQuery;
 
+// changed time range [start, stop] per channel
+using ProgramChanges = QMap<ChannelId, QPair<qint64, qint64>>;
+
+// connections can only be used in the thread which created them
+// instance() belongs to the GUI thread, DatabaseWriter has its own connection for its worker thread
 class Database : public QObject
 {
     Q_OBJECT
@@ -27,7 +37,7 @@ class Database : public QObject
 public:
     static Database &instance()
     {
-        static Database _instance;
+        static Database _instance(QLatin1String(QSqlDatabase::defaultConnection));
         return _instance;
     }
 
@@ -41,6 +51,7 @@ public:
     QVector<GroupData> groups(const ChannelId &channelId) const;
 
     void addChannel(const ChannelData &data, const GroupId &group);
+    void addChannels(const QVector<ChannelData> &channels, const GroupId &group);
     size_t channelCount() const;
     bool channelExists(const ChannelId &id) const;
     QVector<ChannelData> channels(bool onlyFavorites) const;
@@ -57,10 +68,26 @@ public:
     void addProgram(const ProgramData &data);
     void updateProgramDescription(const ProgramId &id, const QString &description);
     void addPrograms(const QVector<ProgramData> &programs);
+    void updatePrograms(const QVector<ProgramData> &programs); // adds or replaces the programs
+    void removePrograms(const QVector<ProgramId> &ids);
     bool programExists(const ChannelId &channelId, qint64 lastTime) const;
+    bool descriptionFetched(const ProgramId &id) const;
     size_t programCount(const ChannelId &channelId) const;
-    QMap<ChannelId, QVector<ProgramData>> programs() const;
     QVector<ProgramData> programs(const ChannelId &channelId) const;
+    // programs of a channel which overlap [from, to] (stop > from, start <= to), ordered by start
+    QVector<ProgramData> programs(const ChannelId &channelId, qint64 from, qint64 to) const;
+    // programs of favorites in [from, to] whose description has not been fetched yet, ordered by start (without categories)
+    QVector<ProgramData> programsWithoutDescription(qint64 from, qint64 to) const;
+
+    ProgramChanges takeProgramChanges(); // written programs since the last call
+
+    // fingerprint of the source from which the programs of a channel have been imported
+    QString importFingerprint(const ChannelId &channelId) const;
+    void setImportFingerprint(const ChannelId &channelId, const QString &fingerprint);
+
+    // days whose programs have been fetched completely (independent of the times covered by the programs)
+    void addFetchedDay(const ChannelId &channelId, const QDate &day);
+    QVector<QDate> fetchedDays(const ChannelId &channelId, const QDate &first, const QDate &last) const; // ascending
 
 Q_SIGNALS:
     void groupAdded(const GroupId &id);
@@ -69,16 +96,36 @@ Q_SIGNALS:
     void favoritesUpdated();
 
 private:
-    Database();
+    friend class DatabaseWriter;
+
+    explicit Database(const QString &connectionName); // the default connection creates/updates the tables
     ~Database() = default;
 
+    bool transaction() const; // nestable
+    bool commit() const;
     int version() const;
     int fetcher() const;
-    bool createTables();
+    bool migrate(); // to the current schema version
+    bool migrate(int version); // from the previous version
+    bool createTables(); // version 1
+    bool addProgramKeys(); // version 2
+    bool addCategoryIds(); // version 3
+    bool addFetchedDays(); // version 4
     bool dropTables();
     void cleanup();
+    void bindProgram(QSqlQuery &query, const ProgramData &data);
+    void addProgramCategories(const ProgramData &data); // IDs which do not fit into the mask
+    void loadCategories(); // dictionary (names of the category IDs)
+    void storeCategories(); // names which have been added to the dictionary since the last call
+    QHash<qint64, QVector<CategoryId>> readCategories(QSqlQuery &query) const; // per program key, from (program, category) rows
+    void addProgramChange(const ChannelId &channelId, qint64 start, qint64 stop);
+    void addProgramChange(const ProgramId &id); // stored time of the program
+    QVector<ProgramData> readPrograms(QSqlQuery &query, const QHash<qint64, QVector<CategoryId>> &categories) const;
 
     const TellySkoutSettings m_settings;
+    mutable QSqlDatabase m_db; // transactions in const functions
+    mutable int m_transactionDepth = 0;
+    ProgramChanges m_programChanges;
 
     std::unique_ptr<QSqlQuery> m_addGroupQuery;
     std::unique_ptr<QSqlQuery> m_groupCountQuery;
@@ -100,13 +147,28 @@ private:
     std::unique_ptr<QSqlQuery> m_favoritesQuery;
     std::unique_ptr<QSqlQuery> m_isFavoriteQuery;
 
+    std::unique_ptr<QSqlQuery> m_addCategoryQuery;
+
     std::unique_ptr<QSqlQuery> m_addProgramCategoryQuery;
-    std::unique_ptr<QSqlQuery> m_programCategoriesQuery;
+    std::unique_ptr<QSqlQuery> m_programCategoriesPerChannelQuery;
+    std::unique_ptr<QSqlQuery> m_programCategoriesInWindowQuery;
+    std::unique_ptr<QSqlQuery> m_removeProgramCategoriesQuery;
 
     std::unique_ptr<QSqlQuery> m_addProgramQuery;
+    std::unique_ptr<QSqlQuery> m_updateProgramQuery;
     std::unique_ptr<QSqlQuery> m_updateProgramDescriptionQuery;
+    std::unique_ptr<QSqlQuery> m_programTimeQuery;
+    std::unique_ptr<QSqlQuery> m_removeProgramQuery;
     std::unique_ptr<QSqlQuery> m_programExistsQuery;
+    std::unique_ptr<QSqlQuery> m_descriptionFetchedQuery;
     std::unique_ptr<QSqlQuery> m_programCountQuery;
-    std::unique_ptr<QSqlQuery> m_programsQuery;
     std::unique_ptr<QSqlQuery> m_programsPerChannelQuery;
+    std::unique_ptr<QSqlQuery> m_programsInWindowQuery;
+    std::unique_ptr<QSqlQuery> m_programsWithoutDescriptionQuery;
+
+    std::unique_ptr<QSqlQuery> m_importFingerprintQuery;
+    std::unique_ptr<QSqlQuery> m_setImportFingerprintQuery;
+
+    std::unique_ptr<QSqlQuery> m_addFetchedDayQuery;
+    std::unique_ptr<QSqlQuery> m_fetchedDaysQuery;
 };
@@ -0,0 +1,194 @@
+// SPDX-FileCopyrightText: none
+// SPDX-License-Identifier: GPL-3.0-only
+
+#include "databasewriter.h"
+
+#include "database.h"
+
+#include <QCoreApplication>
+#include <QDebug>
+#include <QElapsedTimer>
+#include <QMutexLocker>
+#include <QSqlDatabase>
+#include <QTimer>
+
+#include <utility>
+
+namespace
+{
+const char *connectionName = "writer";
+// writes within this time are batched (ms)
+const int batchDelay = 50;
+// no further writes are added to a transaction after this time (ms)
+const int maxTransactionTime = 200;
+}
+
+DatabaseWriter::DatabaseWriter()
+    : m_worker(new QObject)
+{
+    // the tables are created by the connection of the GUI thread
+    Database::instance();
+
+    m_worker->moveToThread(&m_thread);
+    connect(&m_thread, &QThread::finished, m_worker, &QObject::deleteLater);
+    m_thread.setObjectName(QStringLiteral("DatabaseWriter"));
+    m_thread.start();
+
+    QMetaObject::invokeMethod(
+        m_worker,
+        [this]() {
+            m_database = new Database(QLatin1String(connectionName));
+
+            // emitted after the transaction, see finish()
+            connect(m_database, &Database::groupAdded, m_worker, [this](const GroupId &id) {
+                m_notifications.push_back([id]() {
+                    Q_EMIT Database::instance().groupAdded(id);
+                });
+            });
+            connect(m_database, &Database::channelAdded, m_worker, [this](const ChannelId &id) {
+                m_notifications.push_back([id]() {
+                    Q_EMIT Database::instance().channelAdded(id);
+                });
+            });
+            connect(m_database, &Database::channelDetailsUpdated, m_worker, [this](const ChannelId &id, bool favorite) {
+                m_notifications.push_back([id, favorite]() {
+                    Q_EMIT Database::instance().channelDetailsUpdated(id, favorite);
+                });
+            });
+            connect(m_database, &Database::favoritesUpdated, m_worker, [this]() {
+                m_notifications.push_back([]() {
+                    Q_EMIT Database::instance().favoritesUpdated();
+                });
+            });
+
+            // old programs are removed in the background as well
+            m_database->cleanup();
+
+            m_batchTimer = new QTimer(m_worker);
+            m_batchTimer->setSingleShot(true);
+            m_batchTimer->setInterval(batchDelay);
+            connect(m_batchTimer, &QTimer::timeout, m_worker, [this]() {
+                flush();
+            });
+        },
+        Qt::QueuedConnection);
+
+    // the done callbacks are queued to this object, i.e. to the GUI thread (even if the first write comes from a worker thread)
+    QCoreApplication *application = QCoreApplication::instance();
+    if (application) {
+        moveToThread(application->thread());
+        connect(application, &QCoreApplication::aboutToQuit, this, &DatabaseWriter::stop);
+    } else {
+        qWarning() << "Database writer created without application";
+    }
+}
+
+DatabaseWriter::~DatabaseWriter()
+{
+    stop();
+}
+
+bool DatabaseWriter::write(QObject *context, const Write &write, const Done &done, Transaction transaction)
+{
+    Job job;
+    job.m_receiver = context;
+    job.m_write = write;
+    job.m_done = done;
+    job.m_transaction = transaction;
+
+    // the writes requested before stop() are executed by it
+    QMutexLocker locker(&m_mutex);
+    if (m_stopped) {
+        qWarning() << "Database writer stopped, write discarded";
+        return false;
+    }
+    QMetaObject::invokeMethod(
+        m_worker,
+        [this, job]() {
+            m_jobs.push_back(job);
+            if (job.m_transaction == Transaction::Own) {
+                m_batchTimer->stop();
+                flush();
+            } else if (!m_batchTimer->isActive()) {
+                // not restarted by further writes (i.e. delayed by batchDelay at most)
+                m_batchTimer->start();
+            }
+        },
+        Qt::QueuedConnection);
+    return true;
+}
+
+void DatabaseWriter::flush()
+{
+    QVector<Job> pending;
+    std::swap(pending, m_jobs);
+
+    // one transaction instead of one per write, but the GUI connection must not wait too long
+    auto it = pending.cbegin();
+    while (it != pending.cend()) {
+        QElapsedTimer transactionTime;
+        transactionTime.start();
+        QVector<Job> jobs;
+
+        m_database->transaction();
+        do {
+            it->m_write(*m_database);
+            jobs.push_back(*it);
+            ++it;
+        } while (it != pending.cend() && !transactionTime.hasExpired(maxTransactionTime) && jobs.last().m_transaction == Transaction::Shared
+                 && it->m_transaction == Transaction::Shared);
+        m_database->commit();
+
+        finish(jobs);
+    }
+}
+
+void DatabaseWriter::finish(const QVector<Job> &jobs)
+{
+    const ProgramChanges changes = m_database->takeProgramChanges();
+    QVector<Done> notifications;
+    std::swap(notifications, m_notifications);
+
+    // receivers must only be checked in their own thread
+    QMetaObject::invokeMethod(
+        this,
+        [this, jobs, changes, notifications]() {
+            for (const auto &notify : notifications) {
+                notify();
+            }
+            if (!changes.isEmpty()) {
+                Q_EMIT programsChanged(changes);
+            }
+            for (const auto &job : jobs) {
+                if (job.m_done && job.m_receiver) {
+                    job.m_done();
+                }
+            }
+        },
+        Qt::QueuedConnection);
+}
+
+void DatabaseWriter::stop()
+{
+    {
+        QMutexLocker locker(&m_mutex);
+        if (m_stopped) {
+            return;
+        }
+        m_stopped = true;
+    }
+
+    // after the pending writes (in order), the connection must be closed in its own thread
+    QMetaObject::invokeMethod(
+        m_worker,
+        [this]() {
+            m_batchTimer->stop();
+            flush();
+            delete m_database;
+            m_database = nullptr;
+            QSqlDatabase::removeDatabase(QLatin1String(connectionName));
+        },
+        Qt::BlockingQueuedConnection);
+    m_thread.quit();
+    m_thread.wait();
+}
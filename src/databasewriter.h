@@ -0,0 +1,72 @@
+// SPDX-FileCopyrightText: none
+// SPDX-License-Identifier: GPL-3.0-only
+
+#pragma once
+
+#include <QObject>
+
+#include "database.h"
+
+#include <QMutex>
+#include <QPointer>
+#include <QThread>
+#include <QVector>
+
+#include <functional>
+
+class QTimer;
+
+// writes to the database in a worker thread with its own connection (does not block the GUI)
+// the writes are executed in the order in which they have been requested
+// writes which are requested within a short time are executed in one transaction (limited in time, the GUI connection waits for it)
+// signals of the writer connection (e.g. Database::groupAdded) are emitted by Database::instance() after the transaction
+class DatabaseWriter : public QObject
+{
+    Q_OBJECT
+public:
+    using Write = std::function<void(Database &database)>;
+    using Done = std::function<void()>;
+
+    enum class Transaction {
+        Shared, // waits for further writes (up to 50 ms) and shares their transaction
+        Own, // executed without delay in a transaction of its own (e.g. a batch of an import)
+    };
+
+    static DatabaseWriter &instance()
+    {
+        static DatabaseWriter _instance;
+        return _instance;
+    }
+
+    // can be called from any thread, returns false if the write has been discarded (writer stopped)
+    // done is called in the GUI thread after the write (not if context has been destroyed in the meantime)
+    bool write(QObject *context, const Write &write, const Done &done = Done(), Transaction transaction = Transaction::Shared);
+
+Q_SIGNALS:
+    // in the GUI thread after the transaction (before the done callbacks)
+    void programsChanged(const ProgramChanges &changes);
+
+private:
+    struct Job {
+        QPointer<QObject> m_receiver; // only checked in the GUI thread
+        Write m_write;
+        Done m_done;
+        Transaction m_transaction = Transaction::Shared;
+    };
+
+    DatabaseWriter();
+    ~DatabaseWriter();
+
+    void flush(); // executes the pending writes (in m_thread)
+    void finish(const QVector<Job> &jobs); // after the transaction (in m_thread)
+    void stop(); // finishes the pending writes
+
+    QThread m_thread;
+    QObject *m_worker; // lives in m_thread
+    Database *m_database = nullptr; // only used in m_thread
+    QTimer *m_batchTimer = nullptr; // only used in m_thread
+    QVector<Job> m_jobs; // only used in m_thread
+    QVector<Done> m_notifications; // signals of m_database in the current transaction, only used in m_thread
+    QMutex m_mutex; // guards m_stopped
+    bool m_stopped = false;
+};
@@ -0,0 +1,106 @@
+// SPDX-FileCopyrightText: none
+// SPDX-License-Identifier: GPL-3.0-only
+
+#include "descriptionprefetcher.h"
+
+#include "TellySkoutSettings.h"
+#include "database.h"
+#include "fetcherimpl.h"
+
+#include <QDebug>
+#include <QGuiApplication>
+
+#include <algorithm>
+
+namespace
+{
+// seconds between a program and the time window
+qint64 distance(const ProgramData &program, const QDateTime &from, const QDateTime &to)
+{
+    if (program.m_stopTime < from) {
+        return program.m_stopTime.secsTo(from);
+    }
+    return to.secsTo(program.m_startTime);
+}
+}
+
+DescriptionPrefetcher::DescriptionPrefetcher(FetcherImpl &fetcherImpl)
+    : m_fetcherImpl(fetcherImpl)
+{
+    connect(&m_timer, &QTimer::timeout, this, &DescriptionPrefetcher::fetchNext);
+
+    // no background traffic while the application is hidden (an inactive window is still visible)
+    connect(qGuiApp, &QGuiApplication::applicationStateChanged, this, [this](Qt::ApplicationState state) {
+        m_active = state != Qt::ApplicationHidden && state != Qt::ApplicationSuspended;
+        updateTimer();
+    });
+}
+
+void DescriptionPrefetcher::prefetch(const QDateTime &from, const QDateTime &to)
+{
+    m_queue.clear();
+    m_next = 0;
+
+    const TellySkoutSettings settings;
+    const unsigned int rate = settings.descriptionPrefetchRate();
+    if (rate == 0 || !from.isValid() || !to.isValid()) {
+        updateTimer();
+        return;
+    }
+    m_timer.setInterval(static_cast<int>(qMax(1u, 60000u / rate)));
+
+    // the days of the time window
+    const QDateTime dayStart(from.date(), QTime(0, 0));
+    const QDateTime dayStop(to.date().addDays(1), QTime(0, 0));
+    const QVector<ProgramData> programs = Database::instance().programsWithoutDescription(dayStart.toSecsSinceEpoch(), dayStop.toSecsSinceEpoch() - 1);
+
+    // visible programs first (in order of start), then the others (closest to the time window first)
+    // requests for programs which are not returned anymore (other days, description stored) are forgotten
+    QVector<ProgramData> others;
+    QSet<QString> requested;
+    for (const auto &program : programs) {
+        if (m_requested.contains(program.m_id.value())) {
+            requested.insert(program.m_id.value());
+            continue;
+        }
+        if (program.m_stopTime >= from && program.m_startTime <= to) {
+            m_queue.push_back(program);
+        } else {
+            others.push_back(program);
+        }
+    }
+    std::stable_sort(others.begin(), others.end(), [&from, &to](const ProgramData &l, const ProgramData &r) {
+        return distance(l, from, to) < distance(r, from, to);
+    });
+    m_queue += others;
+    m_requested.swap(requested);
+
+    qDebug() << "Prefetching" << m_queue.size() << "descriptions (" << m_queue.size() - others.size() << "visible)";
+    updateTimer();
+}
+
+void DescriptionPrefetcher::fetchNext()
+{
+    if (m_next < m_queue.size()) {
+        const ProgramData &program = m_queue.at(m_next++);
+        m_requested.insert(program.m_id.value());
+        m_fetcherImpl.fetchProgramDescription(program.m_channelId, program.m_id, program.m_url, FetchPriority::Low);
+    }
+
+    if (m_next >= m_queue.size()) {
+        m_queue.clear();
+        m_next = 0;
+    }
+    updateTimer();
+}
+
+void DescriptionPrefetcher::updateTimer()
+{
+    if (m_active && m_next < m_queue.size()) {
+        if (!m_timer.isActive()) {
+            m_timer.start();
+        }
+    } else {
+        m_timer.stop();
+    }
+}
@@ -0,0 +1,37 @@
+// SPDX-FileCopyrightText: none
+// SPDX-License-Identifier: GPL-3.0-only
+
+#pragma once
+
+#include "programdata.h"
+
+#include <QDateTime>
+#include <QObject>
+#include <QSet>
+#include <QString>
+#include <QTimer>
+#include <QVector>
+
+class FetcherImpl;
+
+// fetches the descriptions of favorites in the background (lowest priority): the visible time window first, then the rest of the day
+// limited to a number of requests per minute, paused while the application is hidden
+class DescriptionPrefetcher : public QObject
+{
+    Q_OBJECT
+public:
+    explicit DescriptionPrefetcher(FetcherImpl &fetcherImpl);
+
+    void prefetch(const QDateTime &from, const QDateTime &to); // visible time window
+
+private:
+    void fetchNext();
+    void updateTimer();
+
+    FetcherImpl &m_fetcherImpl;
+    QTimer m_timer;
+    QVector<ProgramData> m_queue; // in fetch order
+    int m_next = 0;
+    QSet<QString> m_requested; // program IDs in the days of the time window (do not request them twice, e.g. if a page has no description)
+    bool m_active = true;
+};
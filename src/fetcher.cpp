@@ -12,11 +12,10 @@
 
 #include <QCryptographicHash>
 #include <QDebug>
-#include <QFile>
 #include <QFileInfo>
-#include <QNetworkAccessManager>
 #include <QNetworkReply>
 #include <QNetworkRequest>
+#include <QSaveFile>
 #include <QStandardPaths>
 
 Fetcher::Fetcher()
@@ -36,10 +35,7 @@ Fetcher::Fetcher()
         assert(false);
     }
 
-    m_manager = new QNetworkAccessManager(this);
-    m_manager->setRedirectPolicy(QNetworkRequest::NoLessSafeRedirectPolicy);
-    m_manager->setStrictTransportSecurityEnabled(true);
-    m_manager->enableStrictTransportSecurityStore(true);
+    m_descriptionPrefetcher.reset(new DescriptionPrefetcher(*m_fetcherImpl));
 
     connect(m_fetcherImpl.get(), &FetcherImpl::startedFetchingGroup, this, [this](const GroupId &id) {
         Q_EMIT startedFetchingGroup(id);
@@ -72,13 +68,18 @@ Fetcher::Fetcher()
     });
 }
 
-void Fetcher::fetchFavorites()
+void Fetcher::fetchFavorites(int visibleCount)
 {
     qDebug() << "Starting to fetch favorites";
 
+    // visible channels first
     const QVector<ChannelId> favoriteChannels = Database::instance().favorites();
-    for (int i = 0; i < favoriteChannels.length(); i++) {
-        m_fetcherImpl->fetchProgram(favoriteChannels.at(i));
+    const int visible = qBound(0, visibleCount, favoriteChannels.size());
+    if (visible > 0) {
+        m_fetcherImpl->fetchPrograms(favoriteChannels.mid(0, visible), FetchPriority::High);
+    }
+    if (visible < favoriteChannels.size()) {
+        m_fetcherImpl->fetchPrograms(favoriteChannels.mid(visible), FetchPriority::Normal);
     }
 }
 
@@ -99,7 +100,13 @@ void Fetcher::fetchGroup(const QString &url, const GroupId &groupId)
 
 void Fetcher::fetchProgramDescription(const QString &channelId, const QString &programId, const QString &url)
 {
-    m_fetcherImpl->fetchProgramDescription(ChannelId(channelId), ProgramId(programId), url);
+    // opened by the user
+    m_fetcherImpl->fetchProgramDescription(ChannelId(channelId), ProgramId(programId), url, FetchPriority::High);
+}
+
+void Fetcher::prefetchDescriptions(const QDateTime &from, const QDateTime &to)
+{
+    m_descriptionPrefetcher->prefetch(from, to);
 }
 
 QString Fetcher::image(const QString &url)
@@ -116,36 +123,41 @@ QString Fetcher::image(const QString &url)
 
 void Fetcher::download(const QString &url)
 {
+    // the image is written to disk as it arrives, the file is replaced only once the download is complete
+    std::shared_ptr<QSaveFile> file(new QSaveFile(filePath(url)));
     QNetworkRequest request((QUrl(url)));
-    QNetworkReply *reply = get(request);
-    connect(reply, &QNetworkReply::finished, this, [this, url, reply]() {
-        if (reply->error() == QNetworkReply::NoError) {
-            QByteArray data = reply->readAll();
-            QFile file(filePath(url));
-            file.open(QIODevice::WriteOnly);
-            file.write(data);
-            file.close();
-        }
-        Q_EMIT imageDownloadFinished(url);
-
-        delete reply;
-    });
-}
-
-void Fetcher::removeImage(const QString &url)
-{
-    qDebug() << "Remove image: " << filePath(url);
-    QFile(filePath(url)).remove();
+    get(
+        request,
+        FetchPriority::Normal,
+        [this, url, file](const FetchResult &result) {
+            // nothing to be done if the image is unchanged and stored already
+            if (result.error == QNetworkReply::NoError && !(result.fromCache && QFileInfo::exists(filePath(url)))) {
+                if (file->isOpen() && !file->commit()) {
+                    qWarning() << "Could not write" << file->fileName() << ":" << file->errorString();
+                }
+            } else if (file->isOpen()) {
+                file->cancelWriting();
+            }
+            Q_EMIT imageDownloadFinished(url);
+        },
+        [this, url, file](const QByteArray &data, bool fromCache) {
+            // not written again if the image is unchanged and stored already
+            if (fromCache && !file->isOpen() && QFileInfo::exists(filePath(url))) {
+                return;
+            }
+            if (!file->isOpen() && !file->open(QIODevice::WriteOnly)) {
+                return;
+            }
+            file->write(data);
+        });
 }
 
-QString Fetcher::filePath(const QString &url)
+void Fetcher::settingsChanged()
 {
-    return QStandardPaths::writableLocation(QStandardPaths::AppDataLocation) + QStringLiteral("/")
-        + QString::fromStdString(QCryptographicHash::hash(url.toUtf8(), QCryptographicHash::Md5).toHex().toStdString());
+    m_fetcherImpl->settingsChanged();
 }
 
-QNetworkReply *Fetcher::get(QNetworkRequest &request)
+void Fetcher::get(QNetworkRequest &request, FetchPriority priority, const FetchScheduler::Callback &callback, const FetchScheduler::DataCallback &dataCallback)
 {
-    request.setRawHeader("User-Agent", "telly-skout/0.1");
-    return m_manager->get(request);
+    FetchScheduler::instance().get(request, priority, this, callback, dataCallback);
 }
@@ -3,6 +3,7 @@
 
 #pragma once
 
+#include "descriptionprefetcher.h"
 #include "fetcherimpl.h"
 #include "types.h"
 
@@ -10,8 +11,7 @@
 
 #include <memory>
 
-class QNetworkAccessManager;
-class QNetworkReply;
+class QDateTime;
 class QNetworkRequest;
 class QString;
 
@@ -24,23 +24,28 @@ public:
         static Fetcher _instance;
         return _instance;
     }
-    Q_INVOKABLE void fetchFavorites();
+    Q_INVOKABLE void fetchFavorites(int visibleCount = 0); // the first visibleCount favorites are fetched first
     Q_INVOKABLE void fetchGroups();
     Q_INVOKABLE void fetchGroup(const QString &url, const QString &groupId);
     void fetchGroup(const QString &url, const GroupId &groupId);
     Q_INVOKABLE void fetchProgramDescription(const QString &channelId, const QString &programId, const QString &url);
+    Q_INVOKABLE void prefetchDescriptions(const QDateTime &from, const QDateTime &to); // visible time window
     Q_INVOKABLE QString image(const QString &url);
     Q_INVOKABLE void download(const QString &url);
+    void settingsChanged(); // the settings have been saved
 
 private:
     Fetcher();
 
     QString filePath(const QString &url);
     void removeImage(const QString &url);
-    QNetworkReply *get(QNetworkRequest &request);
+    void get(QNetworkRequest &request,
+             FetchPriority priority,
+             const FetchScheduler::Callback &callback,
+             const FetchScheduler::DataCallback &dataCallback = FetchScheduler::DataCallback());
 
-    QNetworkAccessManager *m_manager;
     std::unique_ptr<FetcherImpl> m_fetcherImpl;
+    std::unique_ptr<DescriptionPrefetcher> m_descriptionPrefetcher;
 
 Q_SIGNALS:
     void startedFetchingGroup(const GroupId &id);
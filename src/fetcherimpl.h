@@ -5,8 +5,11 @@
 
 #include <QObject>
 
+#include "fetchscheduler.h"
 #include "types.h"
 
+#include <QVector>
+
 class QString;
 
 class FetcherImpl : public QObject
@@ -18,7 +21,17 @@ public:
     virtual void fetchGroups() = 0;
     virtual void fetchGroup(const QString &url, const GroupId &groupId) = 0;
     virtual void fetchProgram(const ChannelId &channelId) = 0;
-    virtual void fetchProgramDescription(const ChannelId &channelId, const ProgramId &programId, const QString &url) = 0;
+    virtual void fetchPrograms(const QVector<ChannelId> &channelIds, FetchPriority priority)
+    {
+        Q_UNUSED(priority)
+        for (const auto &channelId : channelIds) {
+            fetchProgram(channelId);
+        }
+    }
+    virtual void fetchProgramDescription(const ChannelId &channelId, const ProgramId &programId, const QString &url, FetchPriority priority) = 0;
+    virtual void settingsChanged() // the settings have been saved
+    {
+    }
 
 Q_SIGNALS:
     void startedFetchingGroup(const GroupId &id);
@@ -0,0 +1,252 @@
+// SPDX-FileCopyrightText: none
+// SPDX-License-Identifier: GPL-3.0-only
+
+#include "fetchscheduler.h"
+
+#include "TellySkoutSettings.h"
+
+#include <QDebug>
+#include <QNetworkAccessManager>
+#include <QNetworkDiskCache>
+#include <QSslConfiguration>
+#include <QStandardPaths>
+
+namespace
+{
+// number of requests which run in parallel per host
+const int maxRequestsPerHost = 6;
+
+qint64 average(qint64 total, int count)
+{
+    return count > 0 ? total / count : 0;
+}
+}
+
+FetchScheduler::FetchScheduler()
+{
+    m_manager = new QNetworkAccessManager(this);
+    m_manager->setRedirectPolicy(QNetworkRequest::NoLessSafeRedirectPolicy);
+    m_manager->setStrictTransportSecurityEnabled(true);
+    m_manager->enableStrictTransportSecurityStore(true);
+
+    // expired responses are revalidated with conditional requests (If-None-Match/If-Modified-Since)
+    const TellySkoutSettings settings;
+    QNetworkDiskCache *cache = new QNetworkDiskCache(m_manager);
+    cache->setCacheDirectory(QStandardPaths::writableLocation(QStandardPaths::CacheLocation) + QStringLiteral("/network"));
+    cache->setMaximumCacheSize(static_cast<qint64>(settings.networkCacheSize()) * 1024 * 1024);
+    m_manager->setCache(cache);
+}
+
+void FetchScheduler::get(const QNetworkRequest &request, FetchPriority priority, QObject *context, const Callback &callback, const DataCallback &dataCallback)
+{
+    const QString key = request.url().toString();
+    const bool streamed = static_cast<bool>(dataCallback);
+    const Consumer consumer{QPointer<QObject>(context), callback, dataCallback};
+
+    // merge with an identical request (use the highest priority)
+    // streamed data which has already been passed on cannot be replayed
+    const auto it = m_requests.constFind(key);
+    if (it != m_requests.cend() && (*it)->streamed == streamed && !(streamed && (*it)->started)) {
+        (*it)->consumers.push_back(consumer);
+        if (priority < (*it)->priority) {
+            (*it)->priority = priority;
+        }
+        ++m_metrics.mergedCount;
+        ++m_cycleMetrics.mergedCount;
+        qDebug() << "Merged request for" << key;
+        startRequests();
+        return;
+    }
+
+    std::shared_ptr<Request> queued(new Request);
+    queued->request = request;
+    queued->request.setRawHeader("User-Agent", "telly-skout/0.1");
+    // connections are kept alive and shared by all fetchers, HTTP/2 multiplexes the requests to a host over one connection
+    queued->request.setAttribute(QNetworkRequest::HTTP2AllowedAttribute, true);
+    // resume TLS sessions instead of full handshakes for new connections
+    QSslConfiguration sslConfiguration = queued->request.sslConfiguration();
+    sslConfiguration.setSslOption(QSsl::SslOptionDisableSessionTickets, false);
+    sslConfiguration.setSslOption(QSsl::SslOptionDisableSessionPersistence, false);
+    queued->request.setSslConfiguration(sslConfiguration);
+    queued->priority = priority;
+    queued->streamed = streamed;
+    queued->consumers.push_back(consumer);
+    queued->timer.start();
+
+    m_queued.push_back(queued);
+    m_requests.insert(key, queued);
+
+    startRequests();
+}
+
+int FetchScheduler::queueDepth() const
+{
+    return m_queued.size();
+}
+
+int FetchScheduler::runningCount() const
+{
+    return m_runningCount;
+}
+
+int FetchScheduler::finishedCount() const
+{
+    return m_metrics.finishedCount;
+}
+
+int FetchScheduler::mergedCount() const
+{
+    return m_metrics.mergedCount;
+}
+
+qint64 FetchScheduler::averageWaitTime() const
+{
+    return average(m_metrics.totalWaitTime, m_metrics.finishedCount);
+}
+
+qint64 FetchScheduler::averageLatency() const
+{
+    return average(m_metrics.totalLatency, m_metrics.finishedCount);
+}
+
+int FetchScheduler::cacheHitCount() const
+{
+    return m_metrics.cacheHitCount;
+}
+
+qint64 FetchScheduler::savedBytes() const
+{
+    return m_metrics.savedBytes;
+}
+
+QHash<QString, FetchScheduler::HostMetrics> FetchScheduler::hostMetrics() const
+{
+    return m_metrics.hosts;
+}
+
+void FetchScheduler::startRequests()
+{
+    // highest priority first, in order of arrival for the same priority
+    for (const FetchPriority priority : {FetchPriority::High, FetchPriority::Normal, FetchPriority::Low}) {
+        for (int i = 0; i < m_queued.size();) {
+            const std::shared_ptr<Request> request = m_queued.at(i);
+            if (request->priority != priority || m_runningPerHost.value(request->request.url().host()) >= maxRequestsPerHost) {
+                ++i;
+                continue;
+            }
+            m_queued.remove(i);
+            start(request);
+        }
+    }
+}
+
+void FetchScheduler::start(const std::shared_ptr<Request> &request)
+{
+    ++m_runningPerHost[request->request.url().host()];
+    ++m_runningCount;
+    request->waitTime = request->timer.elapsed();
+    request->started = true;
+
+    QNetworkReply *reply = m_manager->get(request->request);
+    connect(reply, &QNetworkReply::encrypted, this, [request]() {
+        request->encrypted = true;
+    });
+    if (request->streamed) {
+        connect(reply, &QNetworkReply::readyRead, this, [this, request, reply]() {
+            readData(request, reply);
+        });
+    }
+    connect(reply, &QNetworkReply::finished, this, [this, request, reply]() {
+        finished(request, reply);
+    });
+}
+
+void FetchScheduler::readData(const std::shared_ptr<Request> &request, QNetworkReply *reply)
+{
+    // error pages are not passed on
+    if (reply->error() != QNetworkReply::NoError || reply->bytesAvailable() <= 0) {
+        return;
+    }
+
+    const QByteArray data = reply->readAll();
+    const bool fromCache = reply->attribute(QNetworkRequest::SourceIsFromCacheAttribute).toBool();
+    request->receivedBytes += data.size();
+    for (const Consumer &consumer : qAsConst(request->consumers)) {
+        if (consumer.context) {
+            consumer.dataCallback(data, fromCache);
+        }
+    }
+}
+
+void FetchScheduler::finished(const std::shared_ptr<Request> &request, QNetworkReply *reply)
+{
+    const QString host = request->request.url().host();
+    if (--m_runningPerHost[host] <= 0) {
+        m_runningPerHost.remove(host);
+    }
+    --m_runningCount;
+    // a streamed request which could not be merged might have replaced this one
+    const QString key = request->request.url().toString();
+    if (m_requests.value(key) == request) {
+        m_requests.remove(key);
+    }
+
+    FetchResult result;
+    result.error = reply->error();
+    result.errorString = reply->errorString();
+    if (result.error == QNetworkReply::NoError) {
+        if (request->streamed) {
+            readData(request, reply);
+        } else {
+            result.data = reply->readAll();
+            request->receivedBytes = result.data.size();
+        }
+        result.fromCache = reply->attribute(QNetworkRequest::SourceIsFromCacheAttribute).toBool();
+    }
+    reply->deleteLater();
+
+    const qint64 latency = request->timer.elapsed();
+    const bool https = request->request.url().scheme() == QLatin1String("https");
+    const bool http2 = reply->attribute(QNetworkRequest::HTTP2WasUsedAttribute).toBool();
+    for (Metrics *metrics : {&m_metrics, &m_cycleMetrics}) {
+        ++metrics->finishedCount;
+        metrics->totalWaitTime += request->waitTime;
+        metrics->totalLatency += latency;
+        if (result.fromCache) {
+            ++metrics->cacheHitCount;
+            metrics->savedBytes += request->receivedBytes;
+        } else {
+            HostMetrics &hostMetrics = metrics->hosts[host];
+            ++hostMetrics.requestCount;
+            hostMetrics.httpsCount += https ? 1 : 0;
+            hostMetrics.newConnectionCount += request->encrypted ? 1 : 0;
+            hostMetrics.http2Count += http2 ? 1 : 0;
+        }
+    }
+    qDebug() << "Fetched" << request->request.url().toString() << (result.fromCache ? "from cache" : "") << "in" << latency << "ms (queued"
+             << request->waitTime << "ms)";
+
+    for (const Consumer &consumer : qAsConst(request->consumers)) {
+        if (consumer.context) {
+            consumer.callback(result);
+        }
+    }
+
+    startRequests();
+    if (m_runningCount == 0 && m_queued.isEmpty()) {
+        logCycle();
+    }
+}
+
+void FetchScheduler::logCycle()
+{
+    const Metrics &metrics = m_cycleMetrics;
+    qDebug() << "Fetched" << metrics.finishedCount << "requests (" << metrics.mergedCount << "merged," << metrics.cacheHitCount << "from cache,"
+             << metrics.savedBytes << "bytes saved), average wait" << average(metrics.totalWaitTime, metrics.finishedCount) << "ms, average latency"
+             << average(metrics.totalLatency, metrics.finishedCount) << "ms";
+    for (auto it = metrics.hosts.cbegin(); it != metrics.hosts.cend(); ++it) {
+        qDebug() << it.key() << ":" << it->requestCount << "requests," << it->reusedCount() << "of" << it->httpsCount << "HTTPS requests on an open connection,"
+                 << it->http2Count << "via HTTP/2";
+    }
+    m_cycleMetrics = Metrics();
+}
@@ -0,0 +1,121 @@
+// SPDX-FileCopyrightText: none
+// SPDX-License-Identifier: GPL-3.0-only
+
+#pragma once
+
+#include <QByteArray>
+#include <QElapsedTimer>
+#include <QHash>
+#include <QNetworkReply>
+#include <QNetworkRequest>
+#include <QObject>
+#include <QPair>
+#include <QPointer>
+#include <QString>
+#include <QVector>
+
+#include <functional>
+#include <memory>
+
+class QNetworkAccessManager;
+
+enum class FetchPriority {
+    High, // e.g. visible channels, descriptions opened by the user
+    Normal,
+    Low, // e.g. prefetching
+};
+
+struct FetchResult {
+    QNetworkReply::NetworkError error = QNetworkReply::NoError;
+    QString errorString;
+    QByteArray data; // empty if the data has been streamed
+    bool fromCache = false; // unchanged since it has been fetched the last time (not modified or still fresh)
+};
+
+// network stack shared by all fetchers (one connection pool, HSTS store and cache)
+// queues all network requests and runs a limited number of them per host (highest priority first)
+// identical requests (same URL) which are queued or running are merged (streamed requests only while they are queued)
+class FetchScheduler : public QObject
+{
+    Q_OBJECT
+public:
+    using Callback = std::function<void(const FetchResult &result)>;
+    using DataCallback = std::function<void(const QByteArray &data, bool fromCache)>; // fromCache as in FetchResult
+
+    // Qt does not expose the connection of a reply, but only a reply which opens a new TLS connection emits encrypted()
+    struct HostMetrics {
+        int requestCount = 0; // sent to the network (not from cache)
+        int httpsCount = 0;
+        int newConnectionCount = 0; // HTTPS requests which opened a TLS connection
+        int http2Count = 0;
+        int reusedCount() const // HTTPS requests on an open connection
+        {
+            return httpsCount - newConnectionCount;
+        }
+    };
+
+    static FetchScheduler &instance()
+    {
+        static FetchScheduler _instance;
+        return _instance;
+    }
+
+    // the callbacks are not called if context has been destroyed in the meantime
+    // with a dataCallback, the data is streamed as it arrives instead of being collected for the callback
+    void get(const QNetworkRequest &request, FetchPriority priority, QObject *context, const Callback &callback, const DataCallback &dataCallback = DataCallback());
+
+    int queueDepth() const;
+    int runningCount() const;
+    int finishedCount() const;
+    int mergedCount() const;
+    qint64 averageWaitTime() const; // ms from queuing to starting a request
+    qint64 averageLatency() const; // ms from queuing to finishing a request
+    int cacheHitCount() const; // hit rate: cacheHitCount / finishedCount
+    qint64 savedBytes() const; // not downloaded because of the cache
+    QHash<QString, HostMetrics> hostMetrics() const;
+
+private:
+    struct Metrics {
+        int finishedCount = 0;
+        int mergedCount = 0;
+        qint64 totalWaitTime = 0;
+        qint64 totalLatency = 0;
+        int cacheHitCount = 0;
+        qint64 savedBytes = 0;
+        QHash<QString, HostMetrics> hosts;
+    };
+
+    struct Consumer {
+        QPointer<QObject> context;
+        Callback callback;
+        DataCallback dataCallback;
+    };
+
+    struct Request {
+        QNetworkRequest request;
+        bool encrypted = false; // opened a TLS connection
+        FetchPriority priority = FetchPriority::Normal;
+        bool streamed = false;
+        bool started = false;
+        qint64 receivedBytes = 0;
+        QVector<Consumer> consumers;
+        QElapsedTimer timer; // since queuing
+        qint64 waitTime = 0;
+    };
+
+    FetchScheduler();
+
+    void startRequests();
+    void start(const std::shared_ptr<Request> &request);
+    void readData(const std::shared_ptr<Request> &request, QNetworkReply *reply);
+    void finished(const std::shared_ptr<Request> &request, QNetworkReply *reply);
+    void logCycle(); // summary of the requests since the queue has been empty the last time
+
+    QNetworkAccessManager *m_manager;
+    QVector<std::shared_ptr<Request>> m_queued; // in order of arrival
+    QHash<QString, std::shared_ptr<Request>> m_requests; // queued or running requests per URL
+    QHash<QString, int> m_runningPerHost;
+    int m_runningCount = 0;
+    Metrics m_metrics; // since the start
+    Metrics m_cycleMetrics; // current fetch cycle
+};
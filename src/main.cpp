@@ -5,6 +5,7 @@
 #include "channelsmodel.h"
 #include "channelsproxymodel.h"
 #include "database.h"
+#include "databasewriter.h"
 #include "fetcher.h"
 #include "groupsmodel.h"
 #include "programsmodel.h"
@@ -12,15 +13,18 @@
 #include "telly-skout-version.h"
 
 #include <KAboutData>
+#include <KConfigGroup>
 #include <KCrash>
 #include <KLocalizedContext>
 #include <KLocalizedString>
+#include <KSharedConfig>
 
 #include <QCommandLineParser>
 #include <QQmlApplicationEngine>
 #include <QQmlContext>
 #include <QQuickStyle>
 #include <QString>
+#include <QStringList>
 
 #ifdef Q_OS_ANDROID
 #include <QGuiApplication>
@@ -28,6 +32,24 @@
 #include <QApplication>
 #endif
 
+namespace
+{
+// the single XMLTV file (String) has been replaced by a list of files (before any settings are read)
+void migrateSettings()
+{
+    KConfigGroup group(KSharedConfig::openConfig(QStringLiteral("tellyskoutrc")), "XMLTV");
+    if (!group.hasKey("xmltvFile")) {
+        return;
+    }
+    if (!group.hasKey("xmltvFiles")) {
+        const QString fileName = group.readEntry("xmltvFile", QString());
+        group.writeEntry("xmltvFiles", fileName.isEmpty() ? QStringList() : QStringList{fileName});
+    }
+    group.deleteEntry("xmltvFile");
+    group.sync();
+}
+}
+
 #ifdef Q_OS_ANDROID
 Q_DECL_EXPORT
 #endif
@@ -46,6 +68,8 @@ int main(int argc, char *argv[])
 
     KCrash::initialize();
 
+    migrateSettings();
+
     // about
     QCoreApplication::setOrganizationName(QStringLiteral("KDE"));
     QCoreApplication::setOrganizationDomain(QStringLiteral("kde.org"));
@@ -91,8 +115,14 @@ int main(int argc, char *argv[])
     engine.rootContext()->setContextProperty(QStringLiteral("_settings"), &settings);
 
     QObject::connect(&app, &QCoreApplication::aboutToQuit, &settings, &TellySkoutSettings::save);
+    // the fetchers read the saved settings
+    QObject::connect(&settings, &TellySkoutSettings::xmltvFilesChanged, &settings, [&settings]() {
+        settings.save();
+        Fetcher::instance().settingsChanged();
+    });
 
     Database::instance();
+    DatabaseWriter::instance(); // removes old programs in the background
 
     engine.load(QUrl(QStringLiteral("qrc:///main.qml")));
 
@@ -3,20 +3,13 @@
 
 #include "networkfetcher.h"
 
-#include <QNetworkAccessManager>
-#include <QNetworkReply>
 #include <QNetworkRequest>
 
 NetworkFetcher::NetworkFetcher()
 {
-    m_manager = new QNetworkAccessManager(this);
-    m_manager->setRedirectPolicy(QNetworkRequest::NoLessSafeRedirectPolicy);
-    m_manager->setStrictTransportSecurityEnabled(true);
-    m_manager->enableStrictTransportSecurityStore(true);
 }
 
-QNetworkReply *NetworkFetcher::get(QNetworkRequest &request)
+void NetworkFetcher::get(QNetworkRequest &request, FetchPriority priority, const FetchScheduler::Callback &callback, const FetchScheduler::DataCallback &dataCallback)
 {
-    request.setRawHeader("User-Agent", "telly-skout/0.1");
-    return m_manager->get(request);
+    FetchScheduler::instance().get(request, priority, this, callback, dataCallback);
 }
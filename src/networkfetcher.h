@@ -5,8 +5,6 @@
 
 #include "fetcherimpl.h"
 
-class QNetworkAccessManager;
-class QNetworkReply;
 class QNetworkRequest;
 
 class NetworkFetcher : public FetcherImpl
@@ -19,11 +17,11 @@ public:
     void fetchGroups() override = 0;
     void fetchGroup(const QString &url, const GroupId &groupId) override = 0;
     void fetchProgram(const ChannelId &channelId) override = 0;
-    void fetchProgramDescription(const ChannelId &channelId, const ProgramId &programId, const QString &url) override = 0;
+    void fetchProgramDescription(const ChannelId &channelId, const ProgramId &programId, const QString &url, FetchPriority priority) override = 0;
 
 protected:
-    QNetworkReply *get(QNetworkRequest &request);
-
-private:
-    QNetworkAccessManager *m_manager;
+    void get(QNetworkRequest &request,
+             FetchPriority priority,
+             const FetchScheduler::Callback &callback,
+             const FetchScheduler::DataCallback &dataCallback = FetchScheduler::DataCallback());
 };
@@ -3,6 +3,7 @@
 
 #include "program.h"
 
+#include "categories.h"
 #include "channel.h"
 #include "database.h"
 
@@ -66,5 +67,5 @@ QString Program::subtitle() const
 
 QVector<QString> Program::categories() const
 {
-    return m_data.m_categories;
+    return Categories::instance().names(m_data.m_categories);
 }
@@ -3,6 +3,7 @@
 
 #pragma once
 
+#include "categories.h"
 #include "types.h"
 
 #include <QDateTime>
@@ -19,5 +20,18 @@ struct ProgramData {
     QString m_subtitle;
     QString m_description;
     bool m_descriptionFetched;
-    QVector<QString> m_categories;
+    CategorySet m_categories; // names: see Categories
+    QVector<QString> m_categoryNames; // sorted, not yet resolved to m_categories (XMLTV import)
 };
+
+inline bool operator==(const ProgramData &l, const ProgramData &r)
+{
+    return l.m_id == r.m_id && l.m_url == r.m_url && l.m_channelId == r.m_channelId && l.m_startTime == r.m_startTime && l.m_stopTime == r.m_stopTime
+        && l.m_title == r.m_title && l.m_subtitle == r.m_subtitle && l.m_description == r.m_description && l.m_descriptionFetched == r.m_descriptionFetched
+        && l.m_categories == r.m_categories && l.m_categoryNames == r.m_categoryNames;
+}
+
+inline bool operator!=(const ProgramData &l, const ProgramData &r)
+{
+    return !(l == r);
+}
@@ -9,42 +9,92 @@
 
 #include <QDebug>
 
+#include <algorithm>
+
 ProgramFactory::ProgramFactory()
     : QObject(nullptr)
-    , m_programs(Database::instance().programs())
 {
 }
 
 size_t ProgramFactory::count(const ChannelId &channelId) const
 {
-    // try to load if not avaible
-    if (!m_programs.contains(channelId)) {
-        load(channelId);
-    }
-    // check if requested data exists
-    if (!m_programs.contains(channelId)) {
+    // nothing before a window has been requested
+    const auto it = m_windows.constFind(channelId);
+    if (it == m_windows.cend()) {
         return 0;
     }
-    return m_programs[channelId].size();
+    return it->m_programs.size();
 }
 
 Program *ProgramFactory::create(const ChannelId &channelId, int index) const
 {
-    // try to load if not avaible
-    if (!m_programs.contains(channelId)) {
-        load(channelId);
-    }
     // check if requested data exists
-    if (!m_programs.contains(channelId) || m_programs[channelId].size() <= index) {
+    const auto it = m_windows.constFind(channelId);
+    if (it == m_windows.cend() || it->m_programs.size() <= index) {
         return nullptr;
     }
-    return new Program(m_programs[channelId].at(index));
+    return new Program(it->m_programs.at(index));
 }
 
 void ProgramFactory::load(const ChannelId &channelId) const
 {
-    if (m_programs.contains(channelId)) {
-        m_programs.remove(channelId);
+    const auto it = m_windows.find(channelId);
+    if (it != m_windows.end()) {
+        it->m_programs = Database::instance().programs(channelId, it->m_from, it->m_to);
+    }
+}
+
+bool ProgramFactory::isLoaded(const ChannelId &channelId, qint64 from, qint64 to) const
+{
+    const auto it = m_windows.constFind(channelId);
+    return it != m_windows.cend() && to > it->m_from && from <= it->m_to;
+}
+
+ProgramFactory::Extension ProgramFactory::extension(const ChannelId &channelId, qint64 from, qint64 to) const
+{
+    Extension extension;
+    const auto it = m_windows.constFind(channelId);
+    if (it == m_windows.cend()) {
+        extension.m_from = from;
+        extension.m_to = to;
+        extension.m_later = Database::instance().programs(channelId, from, to);
+        return extension;
+    }
+
+    extension.m_from = qMin(from, it->m_from);
+    extension.m_to = qMax(to, it->m_to);
+
+    // only the parts outside of the loaded window (programs which overlap its borders are loaded already)
+    if (from < it->m_from) {
+        const qint64 loadedFrom = it->m_from;
+        extension.m_earlier = Database::instance().programs(channelId, from, loadedFrom);
+        extension.m_earlier.erase(std::remove_if(extension.m_earlier.begin(),
+                                                 extension.m_earlier.end(),
+                                                 [loadedFrom](const ProgramData &data) {
+                                                     return data.m_stopTime.toSecsSinceEpoch() > loadedFrom;
+                                                 }),
+                                  extension.m_earlier.end());
+    }
+    if (to > it->m_to) {
+        const qint64 loadedTo = it->m_to;
+        extension.m_later = Database::instance().programs(channelId, loadedTo, to);
+        extension.m_later.erase(std::remove_if(extension.m_later.begin(),
+                                               extension.m_later.end(),
+                                               [loadedTo](const ProgramData &data) {
+                                                   return data.m_startTime.toSecsSinceEpoch() <= loadedTo;
+                                               }),
+                                extension.m_later.end());
+    }
+    return extension;
+}
+
+void ProgramFactory::extend(const ChannelId &channelId, const Extension &extension) const
+{
+    Window &window = m_windows[channelId];
+    window.m_from = extension.m_from;
+    window.m_to = extension.m_to;
+    if (!extension.m_earlier.isEmpty()) {
+        window.m_programs = extension.m_earlier + window.m_programs;
     }
-    m_programs[channelId] = Database::instance().programs(channelId);
+    window.m_programs += extension.m_later;
 }
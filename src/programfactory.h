@@ -13,18 +13,36 @@
 
 class Program;
 
+// programs of a time window per channel (not all stored programs), the window only grows
 class ProgramFactory : public QObject
 {
     Q_OBJECT
 
 public:
+    // programs of a requested window which are not loaded yet
+    struct Extension {
+        qint64 m_from = 0;
+        qint64 m_to = 0;
+        QVector<ProgramData> m_earlier; // before the loaded programs
+        QVector<ProgramData> m_later; // after the loaded programs
+    };
+
     ProgramFactory();
     ~ProgramFactory() = default;
 
     size_t count(const ChannelId &channelId) const;
     Program *create(const ChannelId &channelId, int index) const;
-    void load(const ChannelId &channelId) const;
+    void load(const ChannelId &channelId) const; // reloads the window
+    bool isLoaded(const ChannelId &channelId, qint64 from, qint64 to) const; // [from, to] overlaps the window
+    Extension extension(const ChannelId &channelId, qint64 from, qint64 to) const;
+    void extend(const ChannelId &channelId, const Extension &extension) const;
 
 private:
-    mutable QMap<ChannelId, QVector<ProgramData>> m_programs;
+    struct Window {
+        qint64 m_from = 0;
+        qint64 m_to = 0;
+        QVector<ProgramData> m_programs;
+    };
+
+    mutable QMap<ChannelId, Window> m_windows;
 };
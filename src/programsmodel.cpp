@@ -5,7 +5,7 @@
 
 #include "channel.h"
 #include "database.h"
-#include "fetcher.h"
+#include "databasewriter.h"
 #include "program.h"
 #include "programfactory.h"
 #include "types.h"
@@ -17,10 +17,13 @@ ProgramsModel::ProgramsModel(Channel *channel, ProgramFactory &programFactory)
     , m_channel(channel)
     , m_programFactory(programFactory)
 {
-    connect(&Fetcher::instance(), &Fetcher::channelUpdated, this, [this](const ChannelId &id) {
-        if (m_channel->id() == id.value()) {
+    connect(&DatabaseWriter::instance(), &DatabaseWriter::programsChanged, this, [this](const ProgramChanges &changes) {
+        const ChannelId id(m_channel->id());
+        const auto it = changes.constFind(id);
+        // only if the loaded programs are affected
+        if (it != changes.cend() && m_programFactory.isLoaded(id, it->first, it->second)) {
             beginResetModel();
-            m_programFactory.load(ChannelId(m_channel->id()));
+            m_programFactory.load(id);
             for (auto &program : m_programs) {
                 delete program;
             }
@@ -76,3 +79,29 @@ Channel *ProgramsModel::channel() const
 {
     return m_channel;
 }
+
+void ProgramsModel::requestWindow(const QDateTime &from, const QDateTime &to)
+{
+    if (!from.isValid() || !to.isValid()) {
+        return;
+    }
+
+    const ChannelId channelId(m_channel->id());
+    const ProgramFactory::Extension extension = m_programFactory.extension(channelId, from.toSecsSinceEpoch(), to.toSecsSinceEpoch());
+    if (!extension.m_earlier.isEmpty()) {
+        // shifts the rows (i.e. the loaded programs)
+        beginResetModel();
+        m_programFactory.extend(channelId, extension);
+        qDeleteAll(m_programs);
+        m_programs.clear();
+        endResetModel();
+    } else if (!extension.m_later.isEmpty()) {
+        const int first = m_programFactory.count(channelId);
+        beginInsertRows(QModelIndex(), first, first + extension.m_later.size() - 1);
+        m_programFactory.extend(channelId, extension);
+        endInsertRows();
+    } else {
+        // no new programs, but do not query the window again
+        m_programFactory.extend(channelId, extension);
+    }
+}
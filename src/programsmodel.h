@@ -5,6 +5,7 @@
 
 #include <QAbstractListModel>
 
+#include <QDateTime>
 #include <QHash>
 #include <QObject>
 
@@ -26,6 +27,7 @@ public:
     int rowCount(const QModelIndex &parent) const override;
 
     Channel *channel() const;
+    void requestWindow(const QDateTime &from, const QDateTime &to); // loads the programs of [from, to] (in addition to the loaded ones)
 
 private:
     void loadProgram(int index) const;
@@ -4,12 +4,20 @@
 #include "programsproxymodel.h"
 
 #include "program.h"
+#include "programsmodel.h"
 
 ProgramsProxyModel::ProgramsProxyModel(QObject *parent)
     : QSortFilterProxyModel(parent)
     , m_start{}
     , m_stop{}
 {
+    connect(this, &QAbstractProxyModel::sourceModelChanged, this, &ProgramsProxyModel::requestWindow);
+
+    // the first program may have changed
+    connect(this, &QAbstractItemModel::rowsInserted, this, &ProgramsProxyModel::firstStartChanged);
+    connect(this, &QAbstractItemModel::rowsRemoved, this, &ProgramsProxyModel::firstStartChanged);
+    connect(this, &QAbstractItemModel::modelReset, this, &ProgramsProxyModel::firstStartChanged);
+    connect(this, &QAbstractItemModel::layoutChanged, this, &ProgramsProxyModel::firstStartChanged);
 }
 
 ProgramsProxyModel::~ProgramsProxyModel()
@@ -25,6 +33,7 @@ void ProgramsProxyModel::setStart(const QDateTime &start)
 {
     if (m_start != start) {
         m_start = start;
+        requestWindow();
         invalidateFilter();
         Q_EMIT startChanged();
     }
@@ -39,11 +48,28 @@ void ProgramsProxyModel::setStop(const QDateTime &stop)
 {
     if (m_stop != stop) {
         m_stop = stop;
+        requestWindow();
         invalidateFilter();
         Q_EMIT stopChanged();
     }
 }
 
+QDateTime ProgramsProxyModel::firstStart() const
+{
+    if (rowCount() == 0) {
+        return QDateTime();
+    }
+    return index(0, 0).data(0).value<Program *>()->start();
+}
+
+void ProgramsProxyModel::requestWindow()
+{
+    ProgramsModel *programsModel = qobject_cast<ProgramsModel *>(sourceModel());
+    if (programsModel) {
+        programsModel->requestWindow(m_start, m_stop);
+    }
+}
+
 bool ProgramsProxyModel::filterAcceptsRow(int source_row, const QModelIndex &source_parent) const
 {
     const auto idx = sourceModel()->index(source_row, 0, source_parent);
@@ -7,12 +7,14 @@
 
 #include <QDateTime>
 
+// programs in [start, stop], the source model loads only this time window
 class ProgramsProxyModel : public QSortFilterProxyModel
 {
     Q_OBJECT
 
     Q_PROPERTY(QDateTime start READ start WRITE setStart NOTIFY startChanged)
     Q_PROPERTY(QDateTime stop READ stop WRITE setStop NOTIFY stopChanged)
+    Q_PROPERTY(QDateTime firstStart READ firstStart NOTIFY firstStartChanged) // start of the first program (invalid if there is none)
 
 public:
     explicit ProgramsProxyModel(QObject *parent = nullptr);
@@ -26,11 +28,16 @@ public:
     QDateTime stop() const;
     void setStop(const QDateTime &stop);
 
+    QDateTime firstStart() const;
+
 Q_SIGNALS:
     void startChanged();
     void stopChanged();
+    void firstStartChanged();
 
 private:
+    void requestWindow(); // from the source model
+
     QDateTime m_start;
     QDateTime m_stop;
 };
@@ -35,7 +35,6 @@ Rectangle {
         }
     }
 
-    width: 200
     // start always at startTime, even if program starts earlier
     // stop always at stopTime, even if the program runs longer
     height: (Math.min(program.stop, stopTime) - Math.max(program.start, startTime)) / 60000 * pxPerMin
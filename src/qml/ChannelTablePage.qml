@@ -12,6 +12,7 @@ Kirigami.Page {
     id: root
 
     property int windowHeight: 0
+    readonly property int columnWidth: 200
     property real currentTimestamp: 0
 
     function updateTime() {
@@ -19,10 +20,15 @@ Kirigami.Page {
         currentTimestamp = now.getTime();
     }
 
+    // fetch the descriptions of the visible programs in the background
+    function prefetchDescriptions() {
+        Fetcher.prefetchDescriptions(new Date(channelTable.visibleStart), new Date(channelTable.visibleStop));
+    }
+
     title: i18n("Favorites")
     padding: 0
     Component.onCompleted: {
-        Fetcher.fetchFavorites();
+        Fetcher.fetchFavorites(Math.ceil(root.width / root.columnWidth)); // visible columns first
         updateTime();
     }
 
@@ -33,6 +39,31 @@ Kirigami.Page {
         onTriggered: updateTime()
     }
 
+    // wait until scrolling stops
+    Timer {
+        id: prefetchTimer
+
+        interval: 1000
+        onTriggered: prefetchDescriptions()
+    }
+
+    Connections {
+        function onPositionChanged() {
+            prefetchTimer.restart();
+        }
+
+        target: channelTable.Controls.ScrollBar.vertical
+    }
+
+    // new programs
+    Connections {
+        function onChannelUpdated() {
+            prefetchTimer.restart();
+        }
+
+        target: Fetcher
+    }
+
     Kirigami.PlaceholderMessage {
         visible: contentRepeater.count === 0
         width: Kirigami.Units.gridUnit * 20
@@ -54,7 +85,7 @@ Kirigami.Page {
             model: channelsModel
 
             delegate: Column {
-                width: 200
+                width: root.columnWidth
 
                 Rectangle {
                     color: Kirigami.Theme.backgroundColor
@@ -83,6 +114,16 @@ Kirigami.Page {
         readonly property var date: new Date()
         readonly property var start: new Date(date.getFullYear(), date.getMonth(), date.getDate()) // today 00:00h
         readonly property var stop: new Date(date.getFullYear(), date.getMonth(), date.getDate(), 23, 59, 0) // today 23:59h
+        // visible time window [ms since epoch]
+        readonly property real visibleStart: start.getTime() + Controls.ScrollBar.vertical.position * (stop.getTime() - start.getTime())
+        readonly property real visibleStop: visibleStart + Controls.ScrollBar.vertical.size * (stop.getTime() - start.getTime())
+        // programs are loaded a few hours around the visible ones, in steps of full hours (i.e. not for every scrolled pixel)
+        // nothing is loaded before the initial scroll to the current time
+        readonly property real hour: 60 * 60 * 1000
+        readonly property real loadMargin: 3 * hour
+        property bool scrolled: false
+        readonly property var loadedStart: scrolled ? new Date(Math.max(start.getTime(), Math.floor((visibleStart - loadMargin) / hour) * hour)) : new Date(NaN)
+        readonly property var loadedStop: scrolled ? new Date(Math.min(stop.getTime(), Math.ceil((visibleStop + loadMargin) / hour) * hour)) : new Date(NaN)
 
         visible: contentRepeater.count !== 0
         width: parent.width
@@ -100,6 +141,7 @@ Kirigami.Page {
             const offsetS = (now.getTime() - today.getTime()) / 1000;
             // center in window (vertically)
             Controls.ScrollBar.vertical.position = offsetS / (24 * 60 * 60) - (windowHeight / 2) / channelTable.contentHeight;
+            scrolled = true;
         }
 
         Row {
@@ -115,7 +157,7 @@ Kirigami.Page {
 
                     property int idx: index
 
-                    width: 200
+                    width: root.columnWidth
 
                     // show info if program is not available
                     Rectangle {
@@ -134,18 +176,25 @@ Kirigami.Page {
 
                     }
 
+                    // the programs before the loaded time window are not in the column, keep the loaded ones at their time
+                    Item {
+                        width: parent.width
+                        height: programRepeater.count > 0 ? Math.max(0, proxyProgramModel.firstStart - channelTable.start) / 60000 * channelTable.pxPerMin : 0
+                    }
+
                     Repeater {
                         id: programRepeater
 
                         model: ProgramsProxyModel {
                             id: proxyProgramModel
 
-                            start: channelTable.start
-                            stop: channelTable.stop
+                            start: channelTable.loadedStart
+                            stop: channelTable.loadedStop
                             sourceModel: modelData.programsModel
                         }
 
                         delegate: ChannelTableDelegate {
+                            width: column.width
                             channelIdx: column.idx
                             overlay: overlaySheet
                             pxPerMin: channelTable.pxPerMin
@@ -45,33 +45,60 @@ Kirigami.ScrollablePage {
 
         }
 
-        RowLayout {
+        ColumnLayout {
+            Kirigami.FormData.label: i18n("Files")
             visible: fetcher.currentIndex == 1 // only for XMLTV
 
-            Controls.TextField {
-                id: xmltvFile
+            // in priority order (programs of earlier files win)
+            Repeater {
+                model: _settings.xmltvFiles
+
+                RowLayout {
+                    Controls.Label {
+                        Layout.fillWidth: true
+                        text: modelData
+                        elide: Text.ElideMiddle
+                    }
+
+                    Controls.Button {
+                        icon.name: 'go-up'
+                        enabled: index > 0
+                        onClicked: {
+                            const paths = _settings.xmltvFiles.slice();
+                            paths.splice(index - 1, 0, paths.splice(index, 1)[0]);
+                            _settings.xmltvFiles = paths;
+                        }
+                    }
+
+                    Controls.Button {
+                        icon.name: 'list-remove'
+                        onClicked: {
+                            const paths = _settings.xmltvFiles.slice();
+                            paths.splice(index, 1);
+                            _settings.xmltvFiles = paths;
+                        }
+                    }
+
+                }
 
-                Kirigami.FormData.label: i18n("File")
-                text: _settings.xmltvFile
-                onAccepted: _settings.xmltvFile = text
             }
 
             Controls.Button {
-                icon.name: 'file-search-symbolic'
+                icon.name: 'list-add'
+                text: i18n("Add files")
                 onClicked: fileDialog.open()
             }
 
             FileDialog {
                 id: fileDialog
 
-                nameFilters: [i18n("XML files (*.xml)"), i18n("All files (*)")]
+                nameFilters: [i18n("XML files (*.xml *.xml.gz *.xml.xz *.xml.bz2)"), i18n("All files (*)")]
                 selectExisting: true
-                selectMultiple: false
+                selectMultiple: true
                 onAccepted: {
                     // remove prefixed "file://"
-                    const path = fileUrl.toString().replace(/^(file:\/{2})/, "");
-                    xmltvFile.text = path;
-                    _settings.xmltvFile = path;
+                    const paths = Array.prototype.map.call(fileUrls, url => url.toString().replace(/^(file:\/{2})/, ""));
+                    _settings.xmltvFiles = _settings.xmltvFiles.concat(paths.filter(path => _settings.xmltvFiles.indexOf(path) < 0));
                 }
             }
 
@@ -0,0 +1,104 @@
+// SPDX-FileCopyrightText: none
+// SPDX-License-Identifier: GPL-3.0-only
+
+#include "readaheaddevice.h"
+
+#include <QMutexLocker>
+
+#include <cstring>
+
+ReadAheadDevice::ReadAheadDevice(QIODevice *source, qint64 blockSize, int maxBlocks)
+    : m_source(source)
+    , m_blockSize(blockSize)
+    , m_maxBlocks(maxBlocks)
+{
+    open(QIODevice::ReadOnly | QIODevice::Unbuffered);
+    m_thread.reset(QThread::create([this]() {
+        readSource();
+    }));
+    m_thread->start();
+}
+
+ReadAheadDevice::~ReadAheadDevice()
+{
+    {
+        QMutexLocker locker(&m_mutex);
+        m_stopped = true;
+        m_spaceAvailable.wakeAll();
+    }
+    m_thread->wait();
+}
+
+bool ReadAheadDevice::isSequential() const
+{
+    return true;
+}
+
+bool ReadAheadDevice::atEnd() const
+{
+    QMutexLocker locker(&m_mutex);
+    return m_finished && m_blocks.isEmpty();
+}
+
+qint64 ReadAheadDevice::bytesAvailable() const
+{
+    QMutexLocker locker(&m_mutex);
+    qint64 available = QIODevice::bytesAvailable() - m_offset;
+    for (const auto &block : m_blocks) {
+        available += block.size();
+    }
+    return available;
+}
+
+qint64 ReadAheadDevice::readData(char *data, qint64 maxSize)
+{
+    QMutexLocker locker(&m_mutex);
+
+    // wait for the source (blocks until data is available like a QFile would)
+    while (m_blocks.isEmpty() && !m_finished) {
+        m_blockAvailable.wait(&m_mutex);
+    }
+
+    qint64 read = 0;
+    while (read < maxSize && !m_blocks.isEmpty()) {
+        const QByteArray &block = m_blocks.head();
+        const qint64 count = qMin(maxSize - read, static_cast<qint64>(block.size() - m_offset));
+        memcpy(data + read, block.constData() + m_offset, count);
+        read += count;
+        m_offset += count;
+        if (m_offset >= block.size()) {
+            m_blocks.dequeue();
+            m_offset = 0;
+        }
+    }
+
+    m_spaceAvailable.wakeAll();
+    return read;
+}
+
+qint64 ReadAheadDevice::writeData(const char *data, qint64 maxSize)
+{
+    Q_UNUSED(data)
+    Q_UNUSED(maxSize)
+    return -1;
+}
+
+void ReadAheadDevice::readSource()
+{
+    while (true) {
+        const QByteArray block = m_source->read(m_blockSize);
+
+        QMutexLocker locker(&m_mutex);
+        while (!block.isEmpty() && m_blocks.size() >= m_maxBlocks && !m_stopped) {
+            m_spaceAvailable.wait(&m_mutex);
+        }
+        // end of data, read error or device destroyed
+        if (block.isEmpty() || m_stopped) {
+            m_finished = true;
+            m_blockAvailable.wakeAll();
+            return;
+        }
+        m_blocks.enqueue(block);
+        m_blockAvailable.wakeAll();
+    }
+}
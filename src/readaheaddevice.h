@@ -0,0 +1,49 @@
+// SPDX-FileCopyrightText: none
+// SPDX-License-Identifier: GPL-3.0-only
+
+#pragma once
+
+#include <QIODevice>
+
+#include <QByteArray>
+#include <QMutex>
+#include <QQueue>
+#include <QThread>
+#include <QWaitCondition>
+
+#include <memory>
+
+// sequential read-only device which reads its source in a separate thread
+// (e.g. to decompress data while it is being parsed)
+// the source must not be used by anybody else while the ReadAheadDevice exists
+class ReadAheadDevice : public QIODevice
+{
+public:
+    explicit ReadAheadDevice(QIODevice *source, qint64 blockSize = 256 * 1024, int maxBlocks = 8);
+    ~ReadAheadDevice() override;
+
+    bool isSequential() const override;
+    bool atEnd() const override;
+    qint64 bytesAvailable() const override;
+
+protected:
+    qint64 readData(char *data, qint64 maxSize) override;
+    qint64 writeData(const char *data, qint64 maxSize) override;
+
+private:
+    void readSource();
+
+    QIODevice *m_source;
+    const qint64 m_blockSize;
+    const int m_maxBlocks;
+
+    mutable QMutex m_mutex;
+    QWaitCondition m_blockAvailable;
+    QWaitCondition m_spaceAvailable;
+    QQueue<QByteArray> m_blocks;
+    int m_offset = 0; // in first block
+    bool m_finished = false;
+    bool m_stopped = false;
+
+    std::unique_ptr<QThread> m_thread;
+};
@@ -3,20 +3,66 @@
 
 #include "tvspielfilmfetcher.h"
 
+#include "TellySkoutSettings.h"
+#include "categories.h"
 #include "database.h"
+#include "databasewriter.h"
+#include "tvspielfilmparser.h"
 
 #include <KLocalizedString>
 
 #include <QDateTime>
 #include <QDebug>
-#include <QNetworkReply>
 #include <QNetworkRequest>
-#include <QRegularExpression>
+#include <QPair>
 #include <QString>
-#include <QtXml>
+#include <QUrl>
+#include <QUrlQuery>
+
+namespace
+{
+// maximum number of days which are fetched (starting today)
+const int maxDays = 14;
+
+// consecutive days in [first, last] which have not been fetched (fetched: ascending)
+// a day is fetched if all pages of the day have been stored, even if its programs end early (e.g. a channel which ends before midnight)
+QVector<QPair<QDate, QDate>> missingDays(const QVector<QDate> &fetched, const QDate &first, const QDate &last)
+{
+    QVector<QPair<QDate, QDate>> gaps;
+    auto fetchedDay = fetched.cbegin();
+    for (QDate day = first; day <= last; day = day.addDays(1)) {
+        while (fetchedDay != fetched.cend() && *fetchedDay < day) {
+            ++fetchedDay;
+        }
+        if (fetchedDay != fetched.cend() && *fetchedDay == day) {
+            continue;
+        }
+
+        if (!gaps.isEmpty() && gaps.last().second == day.addDays(-1)) {
+            gaps.last().second = day;
+        } else {
+            gaps.push_back(qMakePair(day, day));
+        }
+    }
+    return gaps;
+}
+
+// without trailing slash
+QString baseUrl()
+{
+    const TellySkoutSettings settings;
+    QString url = settings.tvSpielfilmUrl();
+    while (url.endsWith(QLatin1Char('/'))) {
+        url.chop(1);
+    }
+    return url;
+}
+}
 
 TvSpielfilmFetcher::TvSpielfilmFetcher()
 {
+    // the data of a page must be parsed in order
+    m_parsePool.setMaxThreadCount(1);
 }
 
 void TvSpielfilmFetcher::fetchGroups()
@@ -26,11 +72,16 @@ void TvSpielfilmFetcher::fetchGroups()
 
     Q_EMIT startedFetchingGroup(id);
 
-    const QString url = "https://www.tvspielfilm.de/tv-programm/sendungen";
-
-    Database::instance().addGroup(id, name, url);
+    const QString url = baseUrl() + "/tv-programm/sendungen";
 
-    Q_EMIT groupUpdated(id);
+    DatabaseWriter::instance().write(
+        this,
+        [id, name, url](Database &database) {
+            database.addGroup(id, name, url);
+        },
+        [this, id]() {
+            Q_EMIT groupUpdated(id);
+        });
 }
 
 void TvSpielfilmFetcher::fetchGroup(const QString &url, const GroupId &groupId)
@@ -38,220 +89,322 @@ void TvSpielfilmFetcher::fetchGroup(const QString &url, const GroupId &groupId)
     qDebug() << "Starting to fetch group (" << groupId.value() << ", " << url << ")";
 
     QNetworkRequest request((QUrl(url)));
-    QNetworkReply *reply = get(request);
-    connect(reply, &QNetworkReply::finished, this, [this, url, groupId, reply]() {
-        if (reply->error()) {
+    get(request, FetchPriority::Normal, [this, groupId](const FetchResult &result) {
+        if (result.error) {
             qWarning() << "Error fetching group";
-            qWarning() << reply->errorString();
-            Q_EMIT errorFetchingGroup(groupId, Error(reply->error(), reply->errorString()));
+            qWarning() << result.errorString;
+            Q_EMIT errorFetchingGroup(groupId, Error(result.error, result.errorString));
+            Q_EMIT groupUpdated(groupId);
+        } else if (result.fromCache && Database::instance().channelCount() > 0) {
+            qDebug() << "Channel list not modified, skip parsing";
+            Q_EMIT groupUpdated(groupId);
         } else {
-            QByteArray data = reply->readAll();
-
-            QRegularExpression re("<select name=\\\"channel\\\">.*</select>");
-            re.setPatternOptions(QRegularExpression::DotMatchesEverythingOption);
-            QRegularExpressionMatch match = re.match(data);
-            if (match.hasMatch()) {
-                const QString matched = match.captured(0);
-
-                QDomDocument channelsXml;
-
-                if (!channelsXml.setContent(matched)) {
-                    qWarning() << "Failed to parse XML";
-                }
-
-                QDomNodeList channelNodes = channelsXml.elementsByTagName("option");
-
-                for (int i = 0; i < channelNodes.count(); i++) {
-                    QDomNode channelNode = channelNodes.at(i);
-                    if (channelNode.isElement()) {
-                        const QDomNamedNodeMap &attributes = channelNode.attributes();
-                        const ChannelId id = ChannelId(attributes.namedItem("value").toAttr().value());
-
-                        // exclude groups (e.g. "alle Sender" or "g:1")
-                        if (id.value().length() > 0 && !id.value().contains("g:")) {
-                            const QString &name = channelNode.toElement().text();
-                            fetchChannel(id, name, groupId);
-                        }
-                    }
+            QVector<ChannelData> channels;
+            const QVector<TvSpielfilmParser::ChannelOption> options = TvSpielfilmParser::parseChannels(result.data);
+            for (const auto &option : options) {
+                // exclude groups (e.g. "alle Sender" or "g:1")
+                if (option.id.length() > 0 && !option.id.contains("g:")) {
+                    channels.push_back(channelData(ChannelId(option.id), option.name));
                 }
             }
+            addChannels(channels, groupId);
         }
-        delete reply;
-        Q_EMIT groupUpdated(groupId);
     });
 }
 
-void TvSpielfilmFetcher::fetchChannel(const ChannelId &channelId, const QString &name, const GroupId &group)
+ChannelData TvSpielfilmFetcher::channelData(const ChannelId &channelId, const QString &name)
 {
-    if (!Database::instance().channelExists(channelId)) {
-        ChannelData data;
-        data.m_id = channelId;
-        data.m_name = name;
-
-        // https://www.tvspielfilm.de/tv-programm/sendungen/das-erste,ARD.html
-        data.m_url = "https://www.tvspielfilm.de/tv-programm/sendungen/" + name.toLower().replace(' ', '-') + "," + channelId.value() + ".html";
+    ChannelData data;
+    data.m_id = channelId;
+    data.m_name = name;
 
-        Q_EMIT startedFetchingChannel(data.m_id);
+    // https://www.tvspielfilm.de/tv-programm/sendungen/das-erste,ARD.html
+    data.m_url = baseUrl() + "/tv-programm/sendungen/" + name.toLower().replace(' ', '-') + "," + channelId.value() + ".html";
+    data.m_image = "https://a2.tvspielfilm.de/images/tv/sender/mini/" + channelId.value().toLower() + ".webp";
 
-        data.m_image = "https://a2.tvspielfilm.de/images/tv/sender/mini/" + channelId.value().toLower() + ".webp";
-        Database::instance().addChannel(data, group);
+    return data;
+}
 
-        Q_EMIT channelUpdated(channelId);
-    }
+void TvSpielfilmFetcher::addChannels(const QVector<ChannelData> &channels, const GroupId &groupId)
+{
+    // one write for the whole group, only the new channels are reported
+    std::shared_ptr<QVector<ChannelId>> added(new QVector<ChannelId>());
+    DatabaseWriter::instance().write(
+        this,
+        [channels, groupId, added](Database &database) {
+            for (const auto &data : channels) {
+                if (!database.channelExists(data.m_id)) {
+                    database.addChannel(data, groupId);
+                    added->push_back(data.m_id);
+                }
+            }
+        },
+        [this, groupId, added]() {
+            for (const auto &channelId : qAsConst(*added)) {
+                Q_EMIT startedFetchingChannel(channelId);
+                Q_EMIT channelUpdated(channelId);
+            }
+            Q_EMIT groupUpdated(groupId);
+        });
 }
 
-void TvSpielfilmFetcher::fetchProgramDescription(const ChannelId &channelId, const ProgramId &programId, const QString &url)
+void TvSpielfilmFetcher::fetchProgramDescription(const ChannelId &channelId, const ProgramId &programId, const QString &url, FetchPriority priority)
 {
+    Q_UNUSED(channelId)
+
     qDebug() << "Starting to fetch description for" << programId.value() << "(" << url << ")";
     QNetworkRequest request((QUrl(url)));
-    QNetworkReply *reply = get(request);
-    connect(reply, &QNetworkReply::finished, this, [this, channelId, programId, url, reply]() {
-        if (reply->error()) {
+    get(request, priority, [this, programId, url](const FetchResult &result) {
+        if (result.error) {
             qWarning() << "Error fetching program description";
-            qWarning() << reply->errorString();
+            qWarning() << result.errorString;
+        } else if (result.fromCache && Database::instance().descriptionFetched(programId)) {
+            qDebug() << "Description of" << programId.value() << "not modified, skip parsing";
         } else {
-            QByteArray data = reply->readAll();
-            processDescription(data, url, programId);
-
-            Q_EMIT channelUpdated(channelId);
+            m_parsePool.start([this, programId, url, result]() {
+                const QString description = processDescription(result.data, url);
+                // the program is updated via DatabaseWriter::programsChanged (not the whole channel)
+                DatabaseWriter::instance().write(this, [programId, description](Database &database) {
+                    if (!description.isNull()) {
+                        database.updateProgramDescription(programId, description);
+                    }
+                });
+            });
         }
-        delete reply;
     });
 }
 
 void TvSpielfilmFetcher::fetchProgram(const ChannelId &channelId)
 {
-    QDate today = QDate::currentDate();
-    QDate yesterday = QDate::currentDate().addDays(-1);
-    QDate tomorrow = QDate::currentDate().addDays(1);
-    QSet<QDate> days{tomorrow, today, yesterday}; // backwards such that we can stop early (see below)
-    for (auto day : days) {
-        // check if program is available already
-        const QDateTime utcTime(day, QTime(), Qt::UTC);
-        const qint64 lastTime = utcTime.addDays(1).toSecsSinceEpoch() - 1;
-
-        if (Database::instance().programExists(channelId, lastTime)) {
-            return; // assume that programs from previous days are available
+    fetchPrograms(QVector<ChannelId>{channelId}, FetchPriority::Normal);
+}
+
+void TvSpielfilmFetcher::fetchPrograms(const QVector<ChannelId> &channelIds, FetchPriority priority)
+{
+    // yesterday (programs which are still running) + the configured number of days starting today
+    const TellySkoutSettings settings;
+    const int days = qBound(1, static_cast<int>(settings.tvSpielfilmDays()), maxDays);
+    const QDate first = QDate::currentDate().addDays(-1);
+    const QDate last = QDate::currentDate().addDays(days - 1);
+
+    // request only the days which have not been fetched yet
+    int requestCount = 0;
+    for (const auto &channelId : channelIds) {
+        const QVector<QPair<QDate, QDate>> gaps = missingDays(Database::instance().fetchedDays(channelId, first, last), first, last);
+        if (gaps.isEmpty()) {
+            continue;
         }
 
-        // https://www.tvspielfilm.de/tv-programm/sendungen/?date=2021-11-09&time=day&channel=ARD
-        const QString url = "https://www.tvspielfilm.de/tv-programm/sendungen/?time=day&channel=" + channelId.value();
-        const QString urlDay = url + "&date=" + day.toString("yyyy-MM-dd") + "&page=1";
-        QVector<ProgramData> programs;
-        fetchProgram(channelId, urlDay, programs);
+        Q_EMIT startedFetchingChannel(channelId);
+
+        for (const auto &gap : gaps) {
+            qDebug() << "Missing program for" << channelId.value() << "from" << gap.first << "to" << gap.second;
+            for (QDate day = gap.first; day <= gap.second; day = day.addDays(1)) {
+                // https://www.tvspielfilm.de/tv-programm/sendungen/?date=2021-11-09&time=day&channel=ARD
+                const QString url = baseUrl() + "/tv-programm/sendungen/?time=day&channel=" + channelId.value();
+                const QString urlDay = url + "&date=" + day.toString("yyyy-MM-dd") + "&page=1";
+                fetchProgram(channelId, day, urlDay, priority);
+                ++requestCount;
+            }
+        }
     }
+
+    qDebug() << "Fetching" << requestCount << "days of programs for" << channelIds.size() << "channels";
+}
+
+void TvSpielfilmFetcher::fetchProgram(const ChannelId &channelId, const QDate &day, const QString &url, FetchPriority priority)
+{
+    std::shared_ptr<ProgramPages> pages(new ProgramPages);
+    pages->channelId = channelId;
+    pages->day = day;
+    pages->priority = priority;
+    pages->pages.resize(1);
+    pages->pending = 1;
+    fetchPage(pages, 0, url);
 }
 
-void TvSpielfilmFetcher::fetchProgram(const ChannelId &channelId, const QString &url, QVector<ProgramData> &programs)
+void TvSpielfilmFetcher::fetchPage(const std::shared_ptr<ProgramPages> &pages, int index, const QString &url)
 {
-    qDebug() << "Starting to fetch program for " << channelId.value() << "(" << url << ")";
+    qDebug() << "Starting to fetch program for " << pages->channelId.value() << "(" << url << ")";
 
+    // the page is parsed in a worker thread while it is being downloaded, the results are applied in the GUI thread
+    // (the end of the page is passed through the worker thread as well, i.e. it is handled after all data)
+    std::shared_ptr<TvSpielfilmParser::ProgramPageReader> reader(new TvSpielfilmParser::ProgramPageReader);
+    const ChannelId channelId = pages->channelId;
     QNetworkRequest request((QUrl(url)));
-    QNetworkReply *reply = get(request);
-    connect(reply, &QNetworkReply::finished, this, [this, channelId, url, programs, reply]() {
-        if (reply->error()) {
-            qWarning() << "Error fetching channel";
-            qWarning() << reply->errorString();
-            Q_EMIT errorFetchingChannel(channelId, Error(reply->error(), reply->errorString()));
-        } else {
-            QByteArray data = reply->readAll();
-            QVector<ProgramData> allPrograms(programs);
-            allPrograms.append(processChannel(data, url, channelId));
-
-            // fetch next page
-            QRegularExpression reNextPage(
-                "<ul class=\\\"pagination__items\\\">.*<a href=\\\"(.*?)\\\"\\s*class=\\\"js-track-link pagination__link pagination__link--next\\\"");
-            reNextPage.setPatternOptions(QRegularExpression::DotMatchesEverythingOption);
-            QRegularExpressionMatch matchNextPage = reNextPage.match(data);
-            if (matchNextPage.hasMatch()) {
-                fetchProgram(channelId, matchNextPage.captured(1), allPrograms);
-            } else {
-                // all pages processed, update DB + GUI
-                Database::instance().addPrograms(allPrograms);
-                Q_EMIT channelUpdated(channelId);
+    get(
+        request,
+        pages->priority,
+        [this, pages, index, url, reader](const FetchResult &result) {
+            if (pages->unchanged && result.fromCache) {
+                finishPage(pages, index, url, result, TvSpielfilmParser::ProgramPage());
+                return;
             }
-        }
-        delete reply;
-    });
+            m_parsePool.start([this, pages, index, url, reader, result]() {
+                const TvSpielfilmParser::ProgramPage page = reader->page();
+                QMetaObject::invokeMethod(
+                    this,
+                    [this, pages, index, url, result, page]() {
+                        finishPage(pages, index, url, result, page);
+                    },
+                    Qt::QueuedConnection);
+            });
+        },
+        [this, pages, index, url, reader, channelId](const QByteArray &data, bool fromCache) {
+            // the day may have been stored by another request in the meantime (e.g. the same day requested twice)
+            if (index == 0 && fromCache && !pages->cacheChecked) {
+                pages->cacheChecked = true;
+                pages->unchanged = !Database::instance().fetchedDays(channelId, pages->day, pages->day).isEmpty();
+            }
+            if (pages->unchanged) {
+                return;
+            }
+            m_parsePool.start([this, pages, index, url, reader, channelId, data]() {
+                reader->addData(data);
+                const QVector<ProgramData> programs = processChannel(reader->takeRows(), url, channelId);
+                const bool hasPagination = reader->hasPagination();
+                const TvSpielfilmParser::ProgramPage page = reader->page();
+                QMetaObject::invokeMethod(
+                    this,
+                    [this, pages, index, url, programs, hasPagination, page]() {
+                        pages->pages[index] += programs;
+
+                        // the pagination precedes the end of the page
+                        if (hasPagination) {
+                            fetchMorePages(pages, index, url, page);
+                        }
+                    },
+                    Qt::QueuedConnection);
+            });
+        });
 }
 
-QVector<ProgramData> TvSpielfilmFetcher::processChannel(const QString &infoTable, const QString &url, const ChannelId &channelId)
+void TvSpielfilmFetcher::finishPage(const std::shared_ptr<ProgramPages> &pages,
+                                    int index,
+                                    const QString &url,
+                                    const FetchResult &result,
+                                    const TvSpielfilmParser::ProgramPage &page)
 {
+    if (result.error) {
+        qWarning() << "Error fetching channel";
+        qWarning() << result.errorString;
+        if (!pages->failed) {
+            Q_EMIT errorFetchingChannel(pages->channelId, Error(result.error, result.errorString));
+        }
+        pages->failed = true;
+    } else {
+        fetchMorePages(pages, index, url, page);
+    }
+
+    // all pages processed, update DB + GUI
+    --pages->pending;
+    if (pages->pending > 0 || pages->failed) {
+        return;
+    }
+    const ChannelId channelId = pages->channelId;
+    if (pages->unchanged) {
+        qDebug() << "Program of" << channelId.value() << "on" << pages->day << "not modified, skip parsing";
+        Q_EMIT channelUpdated(channelId);
+        return;
+    }
+    const QDate day = pages->day;
     QVector<ProgramData> programs;
+    for (const auto &programsOfPage : qAsConst(pages->pages)) {
+        programs.append(programsOfPage);
+    }
+    DatabaseWriter::instance().write(
+        this,
+        [programs, channelId, day](Database &database) {
+            database.addPrograms(programs);
+            database.addFetchedDay(channelId, day);
+        },
+        [this, channelId]() {
+            Q_EMIT channelUpdated(channelId);
+        });
+}
 
-    // column with date and time
-    const QString reTime("<strong>(\\d\\d:\\d\\d) - (\\d\\d:\\d\\d)</strong>");
-    const QString reDate("<span>.*? (\\d\\d\\.\\d\\d\\.)</span>");
-    const QString reDateTimeCol("<td class=\\\"col-2\\\">.*?" + reTime + ".*?" + reDate + ".*?</td>");
-
-    // column with title + description URL
-    const QString reDescriptionUrl("<a href=\\\"(https://www.tvspielfilm.de/tv-programm/sendung/.*?\\.html)\\\"");
-    const QString reTitle("<strong>(.*?)</strong>");
-    const QString reTitleCol("<td class=\\\"col-3\\\">.*?" + reDescriptionUrl + ".*?" + reTitle + ".*?</td>");
-
-    // column with category
-    const QString reCategory("<span>(.*?)</span>");
-    const QString reCategoryCol("<td class=\\\"col-4\\\">.*?" + reCategory + ".*?</td>");
-
-    QRegularExpression reProgram("<tr class=\\\"hover\\\">.*?" + reDateTimeCol + ".*?" + reTitleCol + ".*?" + reCategoryCol + ".*?</tr>");
-    reProgram.setPatternOptions(QRegularExpression::DotMatchesEverythingOption);
-    QRegularExpressionMatchIterator it = reProgram.globalMatch(infoTable);
-    while (it.hasNext()) {
-        QRegularExpressionMatch match = it.next();
-        programs.push_back(processProgram(match, url, channelId, !it.hasNext()));
+void TvSpielfilmFetcher::fetchMorePages(const std::shared_ptr<ProgramPages> &pages, int index, const QString &url, const TvSpielfilmParser::ProgramPage &page)
+{
+    // fetch the pages which are not known yet in parallel (the pagination may only show some of them)
+    const int count = qMax(pageCount(page), page.nextPageUrl.isEmpty() ? 0 : index + 2);
+    for (int i = pages->pages.size(); i < count && !pages->failed; ++i) {
+        pages->pages.resize(i + 1);
+        ++pages->pending;
+        fetchPage(pages, i, pageUrl(url, i + 1));
     }
+}
 
-    return programs;
+int TvSpielfilmFetcher::pageCount(const TvSpielfilmParser::ProgramPage &page)
+{
+    int count = 0;
+    for (const QString &url : page.pageUrls) {
+        count = qMax(count, QUrlQuery(QUrl(url)).queryItemValue(QStringLiteral("page")).toInt());
+    }
+    return count;
 }
 
-ProgramData TvSpielfilmFetcher::processProgram(const QRegularExpressionMatch &programMatch, const QString &url, const ChannelId &channelId, bool isLast)
+QString TvSpielfilmFetcher::pageUrl(const QString &url, int page)
 {
-    Q_UNUSED(isLast)
+    QUrl result(url);
+    QUrlQuery query(result);
+    query.removeAllQueryItems(QStringLiteral("page"));
+    query.addQueryItem(QStringLiteral("page"), QString::number(page));
+    result.setQuery(query);
+    return result.toString();
+}
 
+QVector<ProgramData> TvSpielfilmFetcher::processChannel(const QVector<TvSpielfilmParser::ProgramRow> &rows, const QString &url, const ChannelId &channelId)
+{
+    QVector<ProgramData> programs;
+    programs.reserve(rows.size());
+    for (const auto &row : rows) {
+        const ProgramData program = processProgram(row, url, channelId);
+        if (program.m_startTime.isValid()) {
+            programs.push_back(program);
+        }
+    }
+    return programs;
+}
+
+ProgramData TvSpielfilmFetcher::processProgram(const TvSpielfilmParser::ProgramRow &row, const QString &url, const ChannelId &channelId)
+{
     ProgramData programData;
 
-    if (programMatch.hasMatch()) {
-        const QString date = programMatch.captured(3);
-        const QDateTime startTime = QDateTime::fromString(QString::number(QDate::currentDate().year()) + date + programMatch.captured(1), "yyyydd.MM.HH:mm");
-        QDateTime stopTime = QDateTime::fromString(QString::number(QDate::currentDate().year()) + date + programMatch.captured(2), "yyyydd.MM.HH:mm");
-        // ends after midnight
-        if (stopTime < startTime) {
-            stopTime = stopTime.addDays(1);
-        }
-        const QString descriptionUrl = programMatch.captured(4);
-        const QString title = programMatch.captured(5);
-        const QString category = programMatch.captured(6);
-
-        // channel + start time can be used as ID
-        const ProgramId programId = ProgramId(channelId.value() + "_" + QString::number(startTime.toSecsSinceEpoch()));
-
-        programData.m_id = programId;
-        programData.m_url = descriptionUrl;
-        programData.m_channelId = channelId;
-        programData.m_startTime = startTime;
-        programData.m_stopTime = stopTime;
-        programData.m_title = title;
-        programData.m_subtitle = "";
-        programData.m_description = "";
-        programData.m_descriptionFetched = false;
-        programData.m_categories.push_back(category);
-    } else {
+    const QDateTime startTime = QDateTime::fromString(QString::number(QDate::currentDate().year()) + row.date + row.startTime, "yyyydd.MM.HH:mm");
+    QDateTime stopTime = QDateTime::fromString(QString::number(QDate::currentDate().year()) + row.date + row.stopTime, "yyyydd.MM.HH:mm");
+    if (!startTime.isValid()) {
         qWarning() << "Failed to parse program " << url;
+        return programData;
+    }
+    // ends after midnight
+    if (stopTime < startTime) {
+        stopTime = stopTime.addDays(1);
+    }
+
+    // channel + start time can be used as ID
+    const ProgramId programId = ProgramId(channelId.value() + "_" + QString::number(startTime.toSecsSinceEpoch()));
+
+    programData.m_id = programId;
+    programData.m_url = row.descriptionUrl;
+    programData.m_channelId = channelId;
+    programData.m_startTime = startTime;
+    programData.m_stopTime = stopTime;
+    programData.m_title = row.title;
+    programData.m_subtitle = "";
+    programData.m_description = "";
+    programData.m_descriptionFetched = false;
+    if (!row.category.isEmpty()) {
+        programData.m_categories.insert(Categories::instance().id(row.category));
     }
 
     return programData;
 }
 
-void TvSpielfilmFetcher::processDescription(const QString &descriptionPage, const QString &url, const ProgramId &programId)
+QString TvSpielfilmFetcher::processDescription(const QByteArray &descriptionPage, const QString &url)
 {
-    QRegularExpression reDescription("<section class=\\\"broadcast-detail__description\\\">.*?<p>(.*?)</p>");
-    reDescription.setPatternOptions(QRegularExpression::DotMatchesEverythingOption);
-    QRegularExpressionMatch match = reDescription.match(descriptionPage);
-    if (match.hasMatch()) {
-        const QString description = match.captured(1);
-
-        Database::instance().updateProgramDescription(programId, description);
-    } else {
+    const QString description = TvSpielfilmParser::parseDescription(descriptionPage);
+    if (description.isNull()) {
         qWarning() << "Failed to parse program description from" << url;
     }
+    return description;
 }
@@ -5,7 +5,28 @@
 
 #include "networkfetcher.h"
 
+#include "channeldata.h"
 #include "programdata.h"
+#include "tvspielfilmparser.h"
+
+#include <QDate>
+#include <QString>
+#include <QThreadPool>
+#include <QVector>
+
+#include <memory>
+
+// pages of the program of a channel (for one day)
+struct ProgramPages {
+    ChannelId channelId;
+    QDate day;
+    bool cacheChecked = false;
+    bool unchanged = false; // from the cache and the day has been stored already (i.e. not parsed)
+    QVector<QVector<ProgramData>> pages; // in page order
+    FetchPriority priority = FetchPriority::Normal;
+    int pending = 0;
+    bool failed = false;
+};
 
 class TvSpielfilmFetcher : public NetworkFetcher
 {
@@ -17,12 +38,26 @@ public:
     void fetchGroups() override;
     void fetchGroup(const QString &url, const GroupId &groupId) override;
     void fetchProgram(const ChannelId &channelId) override;
-    void fetchProgramDescription(const ChannelId &channelId, const ProgramId &programId, const QString &url) override;
+    void fetchPrograms(const QVector<ChannelId> &channelIds, FetchPriority priority) override;
+    void fetchProgramDescription(const ChannelId &channelId, const ProgramId &programId, const QString &url, FetchPriority priority) override;
 
 private:
-    void fetchChannel(const ChannelId &channelId, const QString &name, const GroupId &group);
-    void fetchProgram(const ChannelId &channelId, const QString &url, QVector<ProgramData> &programs);
-    QVector<ProgramData> processChannel(const QString &infoTable, const QString &url, const ChannelId &channelId);
-    ProgramData processProgram(const QRegularExpressionMatch &programMatch, const QString &url, const ChannelId &channelId, bool isLast);
-    void processDescription(const QString &descriptionPage, const QString &url, const ProgramId &programId);
+    static ChannelData channelData(const ChannelId &channelId, const QString &name);
+    void addChannels(const QVector<ChannelData> &channels, const GroupId &groupId);
+    void fetchProgram(const ChannelId &channelId, const QDate &day, const QString &url, FetchPriority priority);
+    void fetchPage(const std::shared_ptr<ProgramPages> &pages, int index, const QString &url);
+    void finishPage(const std::shared_ptr<ProgramPages> &pages,
+                    int index,
+                    const QString &url,
+                    const FetchResult &result,
+                    const TvSpielfilmParser::ProgramPage &page);
+    void fetchMorePages(const std::shared_ptr<ProgramPages> &pages, int index, const QString &url, const TvSpielfilmParser::ProgramPage &page);
+    static int pageCount(const TvSpielfilmParser::ProgramPage &page);
+    static QString pageUrl(const QString &url, int page);
+    // thread-safe (called in the worker thread)
+    static QVector<ProgramData> processChannel(const QVector<TvSpielfilmParser::ProgramRow> &rows, const QString &url, const ChannelId &channelId);
+    static ProgramData processProgram(const TvSpielfilmParser::ProgramRow &row, const QString &url, const ChannelId &channelId);
+    static QString processDescription(const QByteArray &descriptionPage, const QString &url); // null if there is none
+
+    QThreadPool m_parsePool; // last member: waits for running parsers before the other members are destroyed
 };
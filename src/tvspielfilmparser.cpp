@@ -0,0 +1,337 @@
+// SPDX-FileCopyrightText: none
+// SPDX-License-Identifier: GPL-3.0-only
+
+#include "tvspielfilmparser.h"
+
+#include <algorithm>
+#include <cstring>
+
+namespace
+{
+// independent of the host (e.g. https://www.tvspielfilm.de or a local server with recorded pages)
+const QByteArray descriptionUrlPath("/tv-programm/sendung/");
+
+// forward-only cursor: every search starts where the previous one ended, therefore each part of the page is scanned once
+class Scanner
+{
+public:
+    Scanner()
+        : m_pos(nullptr)
+        , m_end(nullptr)
+    {
+    }
+
+    Scanner(const char *begin, const char *end)
+        : m_pos(begin)
+        , m_end(end)
+    {
+    }
+
+    explicit Scanner(const QByteArray &data)
+        : Scanner(data.constData(), data.constData() + data.size())
+    {
+    }
+
+    // moves behind the next needle, stays if there is none
+    bool skip(const char *needle)
+    {
+        const char *found = find(needle);
+        if (found == m_end) {
+            return false;
+        }
+        m_pos = found + std::strlen(needle);
+        return true;
+    }
+
+    // text up to the next needle, moves behind the needle
+    bool read(const char *needle, QByteArray &text)
+    {
+        const char *found = find(needle);
+        if (found == m_end) {
+            return false;
+        }
+        text = QByteArray(m_pos, static_cast<int>(found - m_pos));
+        m_pos = found + std::strlen(needle);
+        return true;
+    }
+
+    // scanner for the text up to the next needle, moves behind the needle
+    bool section(const char *needle, Scanner &section)
+    {
+        const char *found = find(needle);
+        if (found == m_end) {
+            return false;
+        }
+        section = Scanner(m_pos, found);
+        m_pos = found + std::strlen(needle);
+        return true;
+    }
+
+    bool contains(const char *needle) const
+    {
+        return find(needle) != m_end;
+    }
+
+private:
+    const char *find(const char *needle) const
+    {
+        return std::search(m_pos, m_end, needle, needle + std::strlen(needle));
+    }
+
+    const char *m_pos;
+    const char *m_end;
+};
+
+// resolves character references (e.g. "&amp;" or "&#252;")
+QString decodeEntities(const QByteArray &text)
+{
+    const QString encoded = QString::fromUtf8(text);
+    if (!encoded.contains(QLatin1Char('&'))) {
+        return encoded;
+    }
+
+    QString decoded;
+    decoded.reserve(encoded.size());
+    int pos = 0;
+    while (pos < encoded.size()) {
+        const int begin = encoded.indexOf(QLatin1Char('&'), pos);
+        const int end = begin >= 0 ? encoded.indexOf(QLatin1Char(';'), begin) : -1;
+        if (begin < 0 || end < 0) {
+            break;
+        }
+        decoded += encoded.midRef(pos, begin - pos);
+
+        // plain '&'
+        const QStringRef entity = encoded.midRef(begin + 1, end - begin - 1);
+        if (entity.contains(QLatin1Char('&')) || entity.contains(QLatin1Char(' '))) {
+            decoded += QLatin1Char('&');
+            pos = begin + 1;
+            continue;
+        }
+
+        bool ok = true;
+        if (entity == QLatin1String("amp")) {
+            decoded += QLatin1Char('&');
+        } else if (entity == QLatin1String("lt")) {
+            decoded += QLatin1Char('<');
+        } else if (entity == QLatin1String("gt")) {
+            decoded += QLatin1Char('>');
+        } else if (entity == QLatin1String("quot")) {
+            decoded += QLatin1Char('"');
+        } else if (entity == QLatin1String("apos")) {
+            decoded += QLatin1Char('\'');
+        } else if (entity.startsWith(QLatin1String("#x")) || entity.startsWith(QLatin1String("#X"))) {
+            const uint code = entity.mid(2).toUInt(&ok, 16);
+            if (ok) {
+                decoded += QString::fromUcs4(&code, 1);
+            }
+        } else if (entity.startsWith(QLatin1Char('#'))) {
+            const uint code = entity.mid(1).toUInt(&ok);
+            if (ok) {
+                decoded += QString::fromUcs4(&code, 1);
+            }
+        } else {
+            ok = false;
+        }
+
+        // keep unknown references
+        if (!ok) {
+            decoded += encoded.midRef(begin, end - begin + 1);
+        }
+        pos = end + 1;
+    }
+    decoded += encoded.midRef(pos);
+    return decoded;
+}
+
+// <tr class="hover"> ... </tr> (without the tags)
+bool readRow(Scanner &row, TvSpielfilmParser::ProgramRow &data)
+{
+    Scanner column;
+    QByteArray text;
+
+    // column with date and time: <strong>HH:mm - HH:mm</strong> ... <span>Mi 10.11.</span>
+    if (!row.skip("<td class=\"col-2\">") || !row.section("</td>", column) || !column.skip("<strong>") || !column.read("</strong>", text)) {
+        return false;
+    }
+    const int separator = text.indexOf(" - ");
+    if (separator < 0) {
+        return false;
+    }
+    data.startTime = QString::fromLatin1(text.left(separator).trimmed());
+    data.stopTime = QString::fromLatin1(text.mid(separator + 3).trimmed());
+    if (!column.skip("<span>") || !column.read("</span>", text)) {
+        return false;
+    }
+    data.date = QString::fromLatin1(text.mid(text.lastIndexOf(' ') + 1));
+
+    // column with title + description URL
+    if (!row.skip("<td class=\"col-3\">") || !row.section("</td>", column)) {
+        return false;
+    }
+    bool hasDescriptionUrl = false;
+    while (!hasDescriptionUrl && column.skip("<a href=\"") && column.read("\"", text)) {
+        hasDescriptionUrl = text.contains(descriptionUrlPath) && text.endsWith(".html");
+    }
+    if (!hasDescriptionUrl) {
+        return false;
+    }
+    data.descriptionUrl = QString::fromUtf8(text);
+    if (!column.skip("<strong>") || !column.read("</strong>", text)) {
+        return false;
+    }
+    data.title = QString::fromUtf8(text);
+
+    // column with category
+    if (!row.skip("<td class=\"col-4\">") || !row.section("</td>", column) || !column.skip("<span>") || !column.read("</span>", text)) {
+        return false;
+    }
+    data.category = QString::fromUtf8(text);
+
+    return true;
+}
+
+// <ul class="pagination__items"> ... </ul> (without the tags)
+void readPagination(Scanner &pagination, TvSpielfilmParser::ProgramPage &page)
+{
+    Scanner link;
+    while (pagination.skip("<a ") && pagination.section(">", link)) {
+        const bool isNext = link.contains("pagination__link--next");
+        QByteArray href;
+        if (!link.skip("href=\"") || !link.read("\"", href)) {
+            continue;
+        }
+        const QString url = decodeEntities(href);
+        page.pageUrls.push_back(url);
+        if (isNext) {
+            page.nextPageUrl = url;
+        }
+    }
+}
+}
+
+void TvSpielfilmParser::ProgramPageReader::addData(const QByteArray &data)
+{
+    static const QByteArray rowBegin("<tr class=\"hover\">");
+    static const QByteArray rowEnd("</tr>");
+    static const QByteArray paginationBegin("<ul class=\"pagination__items\">");
+    static const QByteArray paginationEnd("</ul>");
+
+    m_buffer += data;
+
+    int pos = 0; // begin of the unparsed data (or of the current section)
+    while (true) {
+        if (m_section == Section::None) {
+            const int row = m_buffer.indexOf(rowBegin, pos);
+            const int pagination = m_hasPagination ? -1 : m_buffer.indexOf(paginationBegin, pos);
+            if (row < 0 && pagination < 0) {
+                // keep what might be the beginning of a tag
+                pos = std::max(pos, m_buffer.size() - std::max(rowBegin.size(), paginationBegin.size()) + 1);
+                break;
+            }
+            if (pagination < 0 || (row >= 0 && row < pagination)) {
+                m_section = Section::Row;
+                pos = row + rowBegin.size();
+            } else {
+                m_section = Section::Pagination;
+                pos = pagination + paginationBegin.size();
+            }
+            m_searchFrom = pos;
+        }
+
+        const QByteArray &end = m_section == Section::Row ? rowEnd : paginationEnd;
+        const int found = m_buffer.indexOf(end, m_searchFrom);
+        if (found < 0) {
+            // wait for the rest of the section
+            m_searchFrom = std::max(pos, m_buffer.size() - end.size() + 1);
+            break;
+        }
+
+        Scanner section(m_buffer.constData() + pos, m_buffer.constData() + found);
+        if (m_section == Section::Row) {
+            ProgramRow row;
+            if (readRow(section, row)) {
+                m_page.rows.push_back(row);
+            }
+        } else {
+            readPagination(section, m_page);
+            m_hasPagination = true;
+        }
+        m_section = Section::None;
+        pos = found + end.size();
+    }
+
+    m_buffer.remove(0, pos);
+    m_searchFrom -= pos;
+}
+
+QVector<TvSpielfilmParser::ProgramRow> TvSpielfilmParser::ProgramPageReader::takeRows()
+{
+    QVector<ProgramRow> rows;
+    rows.swap(m_page.rows);
+    return rows;
+}
+
+bool TvSpielfilmParser::ProgramPageReader::hasPagination() const
+{
+    return m_hasPagination;
+}
+
+const TvSpielfilmParser::ProgramPage &TvSpielfilmParser::ProgramPageReader::page() const
+{
+    return m_page;
+}
+
+bool TvSpielfilmParser::parseRow(const QByteArray &row, ProgramRow &data)
+{
+    Scanner scanner(row);
+    return readRow(scanner, data);
+}
+
+void TvSpielfilmParser::parsePagination(const QByteArray &pagination, ProgramPage &page)
+{
+    Scanner scanner(pagination);
+    readPagination(scanner, page);
+}
+
+TvSpielfilmParser::ProgramPage TvSpielfilmParser::parseProgramPage(const QByteArray &page)
+{
+    ProgramPageReader reader;
+    reader.addData(page);
+    ProgramPage programPage = reader.page();
+    programPage.rows = reader.takeRows();
+    return programPage;
+}
+
+QVector<TvSpielfilmParser::ChannelOption> TvSpielfilmParser::parseChannels(const QByteArray &page)
+{
+    QVector<ChannelOption> channels;
+
+    Scanner scanner(page);
+    Scanner select;
+    if (!scanner.skip("<select name=\"channel\">") || !scanner.section("</select>", select)) {
+        return channels;
+    }
+
+    // <option value="ARD">Das Erste</option>
+    Scanner option;
+    QByteArray name;
+    while (select.skip("<option") && select.section(">", option) && select.read("</option>", name)) {
+        QByteArray value;
+        if (option.skip("value=\"") && option.read("\"", value)) {
+            channels.push_back(ChannelOption{decodeEntities(value), decodeEntities(name).trimmed()});
+        }
+    }
+
+    return channels;
+}
+
+QString TvSpielfilmParser::parseDescription(const QByteArray &page)
+{
+    Scanner scanner(page);
+    QByteArray description;
+    if (!scanner.skip("<section class=\"broadcast-detail__description\">") || !scanner.skip("<p>") || !scanner.read("</p>", description)) {
+        return QString();
+    }
+    return QString::fromUtf8(description);
+}
@@ -0,0 +1,61 @@
+// SPDX-FileCopyrightText: none
+// SPDX-License-Identifier: GPL-3.0-only
+
+#pragma once
+
+#include <QByteArray>
+#include <QString>
+#include <QStringList>
+#include <QVector>
+
+// extracts the data from TV Spielfilm pages in a single forward scan (no backtracking regular expressions)
+class TvSpielfilmParser
+{
+public:
+    // program table row as shown on the page (not converted)
+    struct ProgramRow {
+        QString startTime; // HH:mm
+        QString stopTime; // HH:mm
+        QString date; // dd.MM.
+        QString descriptionUrl;
+        QString title;
+        QString category;
+    };
+
+    struct ProgramPage {
+        QVector<ProgramRow> rows;
+        QStringList pageUrls; // links of the pagination
+        QString nextPageUrl; // empty on the last page
+    };
+
+    struct ChannelOption {
+        QString id;
+        QString name;
+    };
+
+    // parses a program page while it is being downloaded: complete rows are available before the rest of the page has arrived
+    // only the incomplete tail of the data is kept
+    class ProgramPageReader
+    {
+    public:
+        void addData(const QByteArray &data);
+        QVector<ProgramRow> takeRows(); // rows completed since the last call
+        bool hasPagination() const;
+        const ProgramPage &page() const; // without the taken rows
+
+    private:
+        enum class Section { None, Row, Pagination };
+
+        QByteArray m_buffer;
+        Section m_section = Section::None;
+        int m_searchFrom = 0; // where to continue searching the end of the section
+        bool m_hasPagination = false;
+        ProgramPage m_page;
+    };
+
+    static bool parseRow(const QByteArray &row, ProgramRow &data); // content of <tr class="hover"> ... </tr>
+    static void parsePagination(const QByteArray &pagination, ProgramPage &page); // content of <ul class="pagination__items"> ... </ul>
+    static ProgramPage parseProgramPage(const QByteArray &page);
+    static QVector<ChannelOption> parseChannels(const QByteArray &page);
+    static QString parseDescription(const QByteArray &page); // null if the page has no description
+};
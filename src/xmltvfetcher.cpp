@@ -4,31 +4,428 @@
 #include "xmltvfetcher.h"
 
 #include "TellySkoutSettings.h"
+#include "categories.h"
 #include "database.h"
-#include "programdata.h"
+#include "databasewriter.h"
+#include "readaheaddevice.h"
 
+#include <KCompressionDevice>
 #include <KLocalizedString>
 
+#include <QCryptographicHash>
 #include <QDateTime>
 #include <QDebug>
 #include <QFile>
+#include <QFileInfo>
+#include <QIODevice>
+#include <QMap>
 #include <QString>
+#include <QThread>
+#include <QThreadPool>
+#include <QXmlStreamReader>
 
-XmltvFetcher::XmltvFetcher()
-    : m_doc("xmltv")
+#include <algorithm>
+#include <cstring>
+#include <limits>
+#include <memory>
+#include <vector>
+
+namespace
 {
-    const TellySkoutSettings settings;
+// delay before the XMLTV file is imported after it has changed (writers may need several writes)
+const int importDelay = 2000; // ms
+
+// size limits of the chunks for the parallel import
+const int minChunkSize = 1024 * 1024;
+const int maxChunkSize = 16 * 1024 * 1024;
+
+const QByteArray programmeTag("<programme");
 
-    if (!open(settings.xmltvFile())) {
-        qCritical() << "Failed to open" << settings.xmltvFile();
+// identifies a version of the files without reading them
+QString fileState(const QStringList &fileNames)
+{
+    QStringList states;
+    for (const QString &fileName : fileNames) {
+        const QFileInfo fileInfo(fileName);
+        states.push_back(fileInfo.exists() ? QString::number(fileInfo.size()) + ":" + QString::number(fileInfo.lastModified().toMSecsSinceEpoch()) : QString());
     }
+    return states.join(";");
+}
 
-    connect(&settings, &TellySkoutSettings::xmltvFileChanged, this, [this]() {
-        const TellySkoutSettings settings;
-        if (!open(settings.xmltvFile())) {
-            qCritical() << "Failed to open" << settings.xmltvFile();
+// whether [start, stop) overlaps one of the intervals (start -> stop)
+bool overlaps(const QMap<qint64, qint64> &intervals, qint64 start, qint64 stop)
+{
+    auto it = intervals.lowerBound(start);
+    if (it != intervals.cend() && it.key() < stop) {
+        return true;
+    }
+    if (it != intervals.cbegin()) {
+        --it;
+        if (it.value() > start) {
+            return true;
         }
-    });
+    }
+    return false;
+}
+
+// splits the programs at <programme> boundaries into (at least) chunkCount chunks
+// returns the chunk boundaries (n + 1 positions for n chunks)
+QVector<int> splitPrograms(const QByteArray &data, int chunkCount)
+{
+    QVector<int> chunks;
+
+    const int end = data.lastIndexOf("</tv>");
+    const int begin = data.indexOf(programmeTag);
+    if (begin < 0 || end < begin) {
+        return chunks;
+    }
+
+    const int chunkSize = qBound(minChunkSize, (end - begin) / chunkCount, maxChunkSize);
+
+    chunks.push_back(begin);
+    while (static_cast<qint64>(chunks.last()) + chunkSize < end) {
+        const int boundary = data.indexOf(programmeTag, chunks.last() + chunkSize);
+        if (boundary < 0 || boundary >= end) {
+            break;
+        }
+        chunks.push_back(boundary);
+    }
+    chunks.push_back(end);
+
+    return chunks;
+}
+
+// compares channel IDs with attribute values (without converting them to QString)
+struct ChannelIdLess {
+    bool operator()(const QString &l, const QStringRef &r) const
+    {
+        return l.compare(r) < 0;
+    }
+    bool operator()(const QStringRef &l, const QString &r) const
+    {
+        return l.compare(r) < 0;
+    }
+};
+
+// e.g. <?xml version="1.0" encoding="UTF-8"?>
+QByteArray xmlDeclaration(const QByteArray &data)
+{
+    const QByteArray start = data.left(256);
+    const int index = start.indexOf("?>");
+    if (start.startsWith("<?xml") && index >= 0) {
+        return start.left(index + 2);
+    }
+    return QByteArray();
+}
+
+// read-only device which concatenates the given segments without copying them
+// (QXmlStreamReader decodes data from a device block by block instead of all at once)
+class SegmentDevice : public QIODevice
+{
+public:
+    explicit SegmentDevice(const QVector<QByteArray> &segments)
+        : m_segments(segments)
+    {
+        open(QIODevice::ReadOnly | QIODevice::Unbuffered);
+    }
+
+    bool isSequential() const override
+    {
+        return true;
+    }
+
+    qint64 bytesAvailable() const override
+    {
+        qint64 available = QIODevice::bytesAvailable() - m_offset;
+        for (int i = m_segment; i < m_segments.size(); ++i) {
+            available += m_segments.at(i).size();
+        }
+        return available;
+    }
+
+protected:
+    qint64 readData(char *data, qint64 maxSize) override
+    {
+        qint64 read = 0;
+        while (read < maxSize && m_segment < m_segments.size()) {
+            const QByteArray &segment = m_segments.at(m_segment);
+            const qint64 count = qMin(maxSize - read, segment.size() - m_offset);
+            memcpy(data + read, segment.constData() + m_offset, count);
+            read += count;
+            m_offset += count;
+            if (m_offset >= segment.size()) {
+                ++m_segment;
+                m_offset = 0;
+            }
+        }
+        return read;
+    }
+
+    qint64 writeData(const char *data, qint64 maxSize) override
+    {
+        Q_UNUSED(data)
+        Q_UNUSED(maxSize)
+        return -1;
+    }
+
+private:
+    const QVector<QByteArray> m_segments;
+    int m_segment = 0;
+    qint64 m_offset = 0;
+};
+
+// detect compressed files by their magic number
+KCompressionDevice::CompressionType compressionType(QFile &file)
+{
+    const QByteArray magic = file.peek(6);
+    if (magic.startsWith("\x1f\x8b")) {
+        return KCompressionDevice::GZip;
+    }
+    if (magic.startsWith("\xfd"
+                         "7zXZ")) {
+        return KCompressionDevice::Xz;
+    }
+    if (magic.startsWith("BZh")) {
+        return KCompressionDevice::BZip2;
+    }
+    return KCompressionDevice::None;
+}
+
+// changes whenever the file content changes
+QString fingerprint(QFile &file, const QByteArray &data)
+{
+    QCryptographicHash hash(QCryptographicHash::Md5);
+    if (!data.isEmpty()) {
+        hash.addData(data);
+    } else if (file.seek(0)) {
+        hash.addData(&file);
+        file.seek(0);
+    }
+
+    const QFileInfo info(file);
+    return QString::number(info.size()) + ":" + QString::number(info.lastModified().toMSecsSinceEpoch()) + ":" + QString::fromLatin1(hash.result().toHex());
+}
+
+// days since 1970-01-01 for a date in the proleptic Gregorian calendar
+// see http://howardhinnant.github.io/date_algorithms.html#days_from_civil
+qint64 daysFromCivil(int year, int month, int day)
+{
+    year -= month <= 2 ? 1 : 0;
+    const qint64 era = (year >= 0 ? year : year - 399) / 400;
+    const qint64 yearOfEra = year - era * 400;
+    const qint64 dayOfYear = (153 * (month > 2 ? month - 3 : month + 9) + 2) / 5 + day - 1;
+    const qint64 dayOfEra = yearOfEra * 365 + yearOfEra / 4 - yearOfEra / 100 + dayOfYear;
+    return era * 146097 + dayOfEra - 719468;
+}
+
+// reads count digits, returns false if there are less
+bool readDigits(const QChar *&it, const QChar *end, int count, int &value)
+{
+    value = 0;
+    for (int i = 0; i < count; ++i, ++it) {
+        if (it == end || it->unicode() < '0' || it->unicode() > '9') {
+            return false;
+        }
+        value = value * 10 + (it->unicode() - '0');
+    }
+    return true;
+}
+
+QDateTime parseDateTime(const QStringRef &time)
+{
+    qint64 secsSinceEpoch = 0;
+    if (!XmltvFetcher::parseTime(time, secsSinceEpoch)) {
+        qWarning() << "Failed to parse XMLTV time" << time;
+        return QDateTime();
+    }
+    return QDateTime::fromSecsSinceEpoch(secsSinceEpoch, Qt::UTC);
+}
+
+// assigns the category IDs per batch in import order (i.e. independent of the thread scheduling)
+// new categories are added by descending frequency: the frequent ones get the IDs stored in the bit mask
+void resolveCategories(QVector<ProgramData> &programs)
+{
+    QHash<QString, int> frequencies;
+    for (const auto &program : programs) {
+        for (const auto &name : program.m_categoryNames) {
+            ++frequencies[name];
+        }
+    }
+
+    QVector<QPair<int, QString>> order;
+    order.reserve(frequencies.size());
+    for (auto it = frequencies.cbegin(); it != frequencies.cend(); ++it) {
+        order.push_back(qMakePair(-it.value(), it.key()));
+    }
+    std::sort(order.begin(), order.end());
+
+    QHash<QString, CategoryId> ids;
+    for (const auto &entry : order) {
+        ids.insert(entry.second, Categories::instance().id(entry.second));
+    }
+
+    for (auto &program : programs) {
+        for (const auto &name : program.m_categoryNames) {
+            program.m_categories.insert(ids.value(name));
+        }
+        program.m_categoryNames.clear();
+    }
+}
+}
+
+// an opened XMLTV file (mapped into memory if possible)
+class XmltvSource
+{
+public:
+    explicit XmltvSource(const QString &fileName)
+        : m_file(fileName)
+    {
+    }
+
+    ~XmltvSource()
+    {
+        if (m_mapped) {
+            m_file.unmap(m_mapped);
+        }
+    }
+
+    bool open()
+    {
+        if (!m_file.open(QIODevice::ReadOnly)) {
+            qCritical() << "Failed to open" << m_file.fileName();
+            return false;
+        }
+
+        // map (uncompressed) files to parse them without copying them to memory first, fall back to buffered reads if this is not possible
+        const qint64 size = m_file.size();
+        if (compressionType(m_file) == KCompressionDevice::None && size > 0 && size <= std::numeric_limits<int>::max()) {
+            m_mapped = m_file.map(0, size);
+            if (m_mapped) {
+                m_data = QByteArray::fromRawData(reinterpret_cast<const char *>(m_mapped), static_cast<int>(size));
+            }
+        }
+        return true;
+    }
+
+    QFile &file()
+    {
+        return m_file;
+    }
+
+    // empty if the file is not mapped
+    const QByteArray &data() const
+    {
+        return m_data;
+    }
+
+private:
+    QFile m_file;
+    uchar *m_mapped = nullptr;
+    QByteArray m_data;
+};
+
+QVector<ProgramData> ProgramDiff::changed(const Database &database, const QVector<ProgramData> &programs)
+{
+    // time range of the batch per channel
+    QHash<QString, QPair<qint64, qint64>> ranges;
+    for (const auto &program : programs) {
+        const qint64 start = program.m_startTime.toSecsSinceEpoch();
+        const auto range = ranges.find(program.m_channelId.value());
+        if (range == ranges.end()) {
+            ranges.insert(program.m_channelId.value(), qMakePair(start, start));
+        } else {
+            range->first = qMin(range->first, start);
+            range->second = qMax(range->second, start);
+        }
+    }
+
+    QHash<QString, ProgramData> stored;
+    for (auto it = ranges.cbegin(); it != ranges.cend(); ++it) {
+        const QVector<ProgramData> storedPrograms = database.programs(ChannelId(it.key()), it->first, it->second);
+        for (auto program : storedPrograms) {
+            // the imported programs contain the category names
+            program.m_categoryNames = Categories::instance().names(program.m_categories);
+            std::sort(program.m_categoryNames.begin(), program.m_categoryNames.end());
+            program.m_categories = CategorySet();
+            stored.insert(program.m_id.value(), program);
+        }
+    }
+
+    QVector<ProgramData> changed;
+    for (const auto &program : programs) {
+        const QString &channelId = program.m_channelId.value();
+        const qint64 start = program.m_startTime.toSecsSinceEpoch();
+        if (!m_firstStart.contains(channelId) || start < m_firstStart.value(channelId)) {
+            m_firstStart.insert(channelId, start);
+        }
+        m_first = qMin(m_first, start);
+        m_imported.insert(program.m_id.value());
+
+        const auto storedProgram = stored.constFind(program.m_id.value());
+        if (storedProgram == stored.cend() || *storedProgram != program) {
+            changed.push_back(program);
+            m_changedChannels.insert(channelId);
+        }
+    }
+
+    m_changedCount += changed.size();
+    return changed;
+}
+
+QVector<ProgramId> ProgramDiff::removed(const Database &database, const QVector<ChannelId> &channelIds)
+{
+    QVector<ProgramId> removed;
+
+    // only remove programs in the time range of the import (keep older programs), one channel at a time
+    for (const auto &channelId : channelIds) {
+        const qint64 from = m_firstStart.value(channelId.value(), m_first);
+        if (from == std::numeric_limits<qint64>::max()) {
+            continue;
+        }
+        const QVector<ProgramData> stored = database.programs(channelId, from, std::numeric_limits<qint64>::max());
+        for (const auto &program : stored) {
+            if (program.m_startTime.toSecsSinceEpoch() >= from && !m_imported.contains(program.m_id.value())) {
+                removed.push_back(program.m_id);
+                m_changedChannels.insert(channelId.value());
+            }
+        }
+    }
+
+    m_removedCount += removed.size();
+    return removed;
+}
+
+bool ProgramDiff::hasChanged(const ChannelId &channelId) const
+{
+    return m_changedChannels.contains(channelId.value());
+}
+
+int ProgramDiff::changedCount() const
+{
+    return m_changedCount;
+}
+
+int ProgramDiff::removedCount() const
+{
+    return m_removedCount;
+}
+
+XmltvFetcher::XmltvFetcher()
+{
+    // one import at a time
+    m_importPool.setMaxThreadCount(1);
+
+    m_importTimer.setSingleShot(true);
+    m_importTimer.setInterval(importDelay);
+    connect(&m_importTimer, &QTimer::timeout, this, &XmltvFetcher::importInBackground);
+
+    connect(&m_watcher, &QFileSystemWatcher::fileChanged, this, &XmltvFetcher::fileChanged);
+    connect(&m_watcher, &QFileSystemWatcher::directoryChanged, this, &XmltvFetcher::fileChanged);
+
+    const TellySkoutSettings settings;
+    m_fileNames = settings.xmltvFiles();
+    m_fileState = fileState(m_fileNames);
+    watch();
 }
 
 void XmltvFetcher::fetchGroups()
@@ -38,133 +435,696 @@ void XmltvFetcher::fetchGroups()
 
     Q_EMIT startedFetchingGroup(id);
 
-    TellySkoutSettings settings;
-    Database::instance().addGroup(id, name, settings.xmltvFile());
-
-    Q_EMIT groupUpdated(id);
+    const TellySkoutSettings settings;
+    const QString url = settings.xmltvFiles().join(";");
+    DatabaseWriter::instance().write(
+        this,
+        [id, name, url](Database &database) {
+            database.addGroup(id, name, url);
+        },
+        [this, id]() {
+            Q_EMIT groupUpdated(id);
+        });
 }
 
 void XmltvFetcher::fetchGroup(const QString &url, const GroupId &groupId)
 {
     qDebug() << "Starting to fetch group (" << groupId.value() << ", " << url << ")";
 
-    QDomNodeList nodes = m_doc.elementsByTagName("channel");
-
-    for (int i = 0; i < nodes.count(); i++) {
-        QDomNode elm = nodes.at(i);
-        if (elm.isElement()) {
-            const QDomNamedNodeMap &attributes = elm.attributes();
-            const ChannelId id = ChannelId(attributes.namedItem("id").toAttr().value());
-
-            const QString &name = elm.firstChildElement("display-name").text();
-            const QString &icon = elm.firstChildElement("icon").attributes().namedItem("src").toAttr().value();
+    const TellySkoutSettings settings;
+    const int batchSize = static_cast<int>(qMax(1u, settings.xmltvBatchSize()));
 
-            fetchChannel(id, name, groupId, icon);
+    // parsed in the import thread (i.e. not in the GUI thread and not concurrently with an import), stored by the database writer
+    const QStringList fileNames = settings.xmltvFiles();
+    m_importPool.start([this, fileNames, groupId, batchSize]() {
+        // in source order: existing channels are kept, i.e. the first source wins for duplicate channel IDs
+        for (const QString &fileName : fileNames) {
+            QFile file(fileName);
+            if (!file.open(QIODevice::ReadOnly)) {
+                qCritical() << "Failed to open" << file.fileName();
+                errorInGroup(groupId, Error(file.error(), file.errorString()));
+                continue;
+            }
+            fetchChannels(file, groupId, batchSize);
         }
-    }
 
-    Q_EMIT groupUpdated(groupId);
+        // after the channels have been stored
+        DatabaseWriter::instance().write(
+            this,
+            [](Database &database) {
+                Q_UNUSED(database)
+            },
+            [this, groupId]() {
+                Q_EMIT groupUpdated(groupId);
+            });
+    });
 }
 
 void XmltvFetcher::fetchProgram(const ChannelId &channelId)
 {
-    QDomNodeList programs = m_doc.elementsByTagName("programme");
-    for (int i = 0; i < programs.count(); i++) {
-        const QDomNode &program = programs.at(i);
-        const QDomNamedNodeMap &attributes = program.attributes();
+    fetchPrograms(QVector<ChannelId>{channelId}, FetchPriority::Normal);
+}
 
-        if (channelId.value() != attributes.namedItem("channel").toAttr().value()) {
-            continue; // TODO: do not loop all programs for each channel
+void XmltvFetcher::fetchPrograms(const QVector<ChannelId> &channelIds, FetchPriority priority)
+{
+    Q_UNUSED(priority) // local files only
+
+    // import the channels of all calls in the current event loop iteration in one pass (e.g. visible and other favorites)
+    if (m_requestedChannels.isEmpty()) {
+        QTimer::singleShot(0, this, &XmltvFetcher::importRequestedChannels);
+    }
+    for (const auto &channelId : channelIds) {
+        if (!m_requestedChannels.contains(channelId)) {
+            m_requestedChannels.push_back(channelId);
         }
-        processProgram(program);
+    }
+}
+
+void XmltvFetcher::importRequestedChannels()
+{
+    // one import at a time, the channels requested in the meantime are imported afterwards
+    if (m_importRunning) {
+        return;
     }
 
-    Q_EMIT channelUpdated(channelId);
+    const QVector<ChannelId> channelIds = m_requestedChannels;
+    m_requestedChannels.clear();
+    startImport(channelIds, true);
 }
 
-void XmltvFetcher::fetchProgramDescription(const ChannelId &channelId, const ProgramId &programId, const QString &url)
+void XmltvFetcher::fetchProgramDescription(const ChannelId &channelId, const ProgramId &programId, const QString &url, FetchPriority priority)
 {
     Q_UNUSED(channelId)
     Q_UNUSED(programId)
     Q_UNUSED(url)
+    Q_UNUSED(priority)
 
     // nothing to be done (already fetched as part of the program)
 }
 
-bool XmltvFetcher::open(const QString &fileName)
+bool XmltvFetcher::openSources(const QStringList &fileNames, XmltvSources &sources, QString &sourcesFingerprint, Error &error) const
 {
-    QFile file(fileName);
-    if (!file.open(QIODevice::ReadOnly)) {
+    if (fileNames.isEmpty()) {
+        qCritical() << "No XMLTV file configured";
+        error = Error(QFileDevice::OpenError, i18n("No XMLTV file configured"));
         return false;
     }
-    if (!m_doc.setContent(&file)) {
-        file.close();
-        return false;
+
+    QStringList fingerprints;
+    for (const QString &fileName : fileNames) {
+        std::unique_ptr<XmltvSource> source(new XmltvSource(fileName));
+        if (!source->open()) {
+            error = Error(source->file().error(), source->file().errorString());
+            return false;
+        }
+        fingerprints.push_back(fingerprint(source->file(), source->data()));
+        sources.push_back(std::move(source));
     }
-    file.close();
+
+    // identical to the fingerprint of the file for a single source
+    sourcesFingerprint = fingerprints.join(";");
     return true;
 }
 
-void XmltvFetcher::fetchChannel(const ChannelId &channelId, const QString &name, const GroupId &groupId, const QString &icon)
+void XmltvFetcher::watch()
 {
-    if (!Database::instance().channelExists(channelId)) {
-        Q_EMIT startedFetchingChannel(channelId);
+    // writers which replace a file atomically (write + rename) remove it from the watcher, therefore watch the directories as well
+    for (const QString &fileName : qAsConst(m_fileNames)) {
+        const QFileInfo fileInfo(fileName);
+        if (!m_watcher.directories().contains(fileInfo.absolutePath())) {
+            m_watcher.addPath(fileInfo.absolutePath());
+        }
+        if (fileInfo.exists() && !m_watcher.files().contains(fileName)) {
+            m_watcher.addPath(fileName);
+        }
+    }
+}
 
-        ChannelData data;
-        data.m_id = channelId;
-        data.m_name = name;
-        data.m_url = "";
-        data.m_image = icon;
-        Database::instance().addChannel(data, groupId);
+void XmltvFetcher::settingsChanged()
+{
+    const TellySkoutSettings settings;
+    const QStringList fileNames = settings.xmltvFiles();
+    if (fileNames == m_fileNames) {
+        return;
+    }
 
-        Q_EMIT channelUpdated(channelId);
+    // stop watching the previous files and directories
+    QStringList paths;
+    for (const QString &fileName : qAsConst(m_fileNames)) {
+        paths.push_back(fileName);
+        paths.push_back(QFileInfo(fileName).absolutePath());
+    }
+    paths.removeDuplicates();
+    const QStringList watched = m_watcher.files() + m_watcher.directories();
+    paths.erase(std::remove_if(paths.begin(),
+                               paths.end(),
+                               [&watched](const QString &path) {
+                                   return !watched.contains(path);
+                               }),
+                paths.end());
+    if (!paths.isEmpty()) {
+        m_watcher.removePaths(paths);
     }
+
+    m_fileNames = fileNames;
+    m_fileState = fileState(m_fileNames);
+    watch();
+
+    // the favorites are imported from the new files
+    m_importTimer.stop();
+    importInBackground();
 }
 
-void XmltvFetcher::processGroup(const QDomElement &group)
+void XmltvFetcher::fileChanged()
 {
-    const GroupId id = GroupId(group.attributes().namedItem("id").toAttr().value());
-    const QString &name = group.text();
+    // the directories also change if other files are modified
+    const QString state = fileState(m_fileNames);
+    if (state == m_fileState) {
+        return;
+    }
+    m_fileState = state;
 
-    Q_EMIT startedFetchingGroup(id);
+    // debounce
+    m_importTimer.start();
+}
+
+void XmltvFetcher::importInBackground()
+{
+    watch();
+
+    if (m_importRunning) {
+        m_importPending = true;
+        return;
+    }
+
+    qDebug() << "XMLTV files changed, import in background";
+    startImport(Database::instance().favorites(), false);
+}
+
+void XmltvFetcher::startImport(const QVector<ChannelId> &channelIds, bool reportErrors)
+{
+    if (channelIds.isEmpty()) {
+        return;
+    }
+
+    const TellySkoutSettings settings;
+    std::shared_ptr<BackgroundImport> import(new BackgroundImport(channelIds));
+    import->fileNames = settings.xmltvFiles();
+    import->threadCount = settings.xmltvImportThreads() > 0 ? static_cast<int>(settings.xmltvImportThreads()) : QThread::idealThreadCount();
+    import->batchSize = static_cast<int>(qMax(1u, settings.xmltvBatchSize()));
+    import->reportErrors = reportErrors;
+
+    // the stored data is read by the database writer (i.e. not in the GUI thread), the files are parsed afterwards
+    m_importRunning = true;
+    DatabaseWriter::instance().write(
+        this,
+        [import](Database &database) {
+            for (const auto &channelId : import->channelIds) {
+                import->storedFingerprints.insert(channelId.value(), database.importFingerprint(channelId));
+            }
+        },
+        [this, import]() {
+            m_importPool.start([this, import]() {
+                parseInBackground(import);
+                QMetaObject::invokeMethod(
+                    this,
+                    [this, import]() {
+                        applyImport(import);
+                    },
+                    Qt::QueuedConnection);
+            });
+        });
+}
+
+void XmltvFetcher::parseInBackground(const std::shared_ptr<BackgroundImport> &import)
+{
+    // no database access in here (runs in a worker thread), the batches are compared and stored by the database writer
+    XmltvSources sources;
+    if (!openSources(import->fileNames, sources, import->fingerprint, import->error)) {
+        return;
+    }
+
+    // skip the import if all channels have been imported from the same files already
+    bool unchanged = true;
+    for (const auto &channelId : import->channelIds) {
+        unchanged &= import->storedFingerprints.value(channelId.value()) == import->fingerprint;
+    }
+    if (unchanged) {
+        qDebug() << "XMLTV files unchanged, skip import";
+        return;
+    }
+
+    // batches of the same size (independent of the chunks and sources), i.e. the category IDs do not depend on the threads
+    QVector<ProgramData> batch;
+    batch.reserve(import->batchSize);
+    bool written = true;
+    const auto writeBatch = [this, &import, &batch, &written]() {
+        if (!written) {
+            // the writer has been stopped
+            batch.clear();
+            return;
+        }
+        // at most one batch is parsed while the previous one is written
+        import->writable.acquire();
+        written = DatabaseWriter::instance().write(
+            this,
+            [import, batch](Database &database) {
+                QVector<ProgramData> changed = import->diff.changed(database, batch);
+                resolveCategories(changed);
+                database.updatePrograms(changed);
+                import->writable.release();
+            },
+            DatabaseWriter::Done(),
+            DatabaseWriter::Transaction::Own);
+        batch.clear();
+    };
+
+    const auto store = [import, &batch, &writeBatch](const QVector<ProgramData> &programs) {
+        for (const auto &program : programs) {
+            batch.push_back(program);
+            if (batch.size() >= import->batchSize) {
+                writeBatch();
+            }
+        }
+    };
+    import->success = importSources(sources, import->channelIds, import->threadCount, import->batchSize, store);
+    if (!batch.isEmpty()) {
+        writeBatch();
+    }
+    import->success &= written;
+}
+
+void XmltvFetcher::applyImport(const std::shared_ptr<BackgroundImport> &import)
+{
+    if (!import->success && import->reportErrors && import->error.m_id != 0) {
+        for (const auto &channelId : import->channelIds) {
+            Q_EMIT errorFetchingChannel(channelId, import->error);
+        }
+    }
+
+    // after the batches (the next import starts afterwards, it compares with the stored programs)
+    // a failed import keeps the programs which are not in the files (they may only be missing due to the error)
+    DatabaseWriter::instance().write(
+        this,
+        [import](Database &database) {
+            if (!import->success) {
+                return;
+            }
+            database.removePrograms(import->diff.removed(database, import->channelIds));
+            for (const auto &channelId : import->channelIds) {
+                database.setImportFingerprint(channelId, import->fingerprint);
+            }
+        },
+        [this, import]() {
+            for (const auto &channelId : import->channelIds) {
+                if (import->diff.hasChanged(channelId)) {
+                    Q_EMIT channelUpdated(channelId);
+                }
+            }
+            importFinished();
+        });
+}
+
+void XmltvFetcher::importFinished()
+{
+    m_importRunning = false;
+
+    if (!m_requestedChannels.isEmpty()) {
+        importRequestedChannels();
+    } else if (m_importPending) {
+        // the files changed again during the import
+        m_importPending = false;
+        importInBackground();
+    }
+}
+
+void XmltvFetcher::fetchChannels(QFile &file, const GroupId &groupId, int batchSize)
+{
+    // decompress on the fly (no temporary file)
+    const KCompressionDevice::CompressionType compression = compressionType(file);
+    std::unique_ptr<KCompressionDevice> decompressor;
+    QIODevice *device = &file;
+    if (compression != KCompressionDevice::None) {
+        decompressor.reset(new KCompressionDevice(&file, false, compression));
+        if (!decompressor->open(QIODevice::ReadOnly)) {
+            qCritical() << "Failed to decompress" << file.fileName();
+            errorInGroup(groupId, Error(decompressor->error(), decompressor->errorString()));
+            return;
+        }
+        device = decompressor.get();
+    }
+
+    // stream the file instead of loading it completely (XMLTV files can be huge)
+    QXmlStreamReader xml(device);
+    QVector<ChannelData> channels;
+    channels.reserve(batchSize);
+    if (xml.readNextStartElement()) { // <tv>
+        while (xml.readNextStartElement()) {
+            if (xml.name() == QLatin1String("channel")) {
+                channels.push_back(processChannel(xml));
+                if (channels.size() >= batchSize) {
+                    addChannels(channels, groupId);
+                    channels.clear();
+                }
+            } else {
+                xml.skipCurrentElement();
+            }
+        }
+    }
+    addChannels(channels, groupId);
+
+    if (xml.hasError()) {
+        qWarning() << "Failed to parse" << file.fileName() << ":" << xml.errorString();
+    }
+}
+
+void XmltvFetcher::errorInGroup(const GroupId &groupId, const Error &error)
+{
+    // called in the import thread
+    QMetaObject::invokeMethod(
+        this,
+        [this, groupId, error]() {
+            Q_EMIT errorFetchingGroup(groupId, error);
+        },
+        Qt::QueuedConnection);
+}
+
+void XmltvFetcher::addChannels(const QVector<ChannelData> &channels, const GroupId &groupId)
+{
+    if (channels.isEmpty()) {
+        return;
+    }
+
+    // one transaction per batch, only the new channels are reported
+    std::shared_ptr<QVector<ChannelId>> added(new QVector<ChannelId>());
+    DatabaseWriter::instance().write(
+        this,
+        [channels, groupId, added](Database &database) {
+            for (const auto &data : channels) {
+                if (!database.channelExists(data.m_id)) {
+                    database.addChannel(data, groupId);
+                    added->push_back(data.m_id);
+                }
+            }
+        },
+        [this, added]() {
+            for (const auto &channelId : qAsConst(*added)) {
+                Q_EMIT startedFetchingChannel(channelId);
+                Q_EMIT channelUpdated(channelId);
+            }
+        },
+        DatabaseWriter::Transaction::Own);
+}
+
+ChannelData XmltvFetcher::processChannel(QXmlStreamReader &xml) const
+{
+    ChannelData data;
+    data.m_id = ChannelId(xml.attributes().value(QLatin1String("id")).toString());
+    data.m_url = "";
+
+    // use the first name and icon
+    bool hasName = false;
+    bool hasIcon = false;
+    while (xml.readNextStartElement()) {
+        if (!hasName && xml.name() == QLatin1String("display-name")) {
+            data.m_name = xml.readElementText(QXmlStreamReader::IncludeChildElements);
+            hasName = true;
+        } else if (!hasIcon && xml.name() == QLatin1String("icon")) {
+            data.m_image = xml.attributes().value(QLatin1String("src")).toString();
+            hasIcon = true;
+            xml.skipCurrentElement();
+        } else {
+            xml.skipCurrentElement();
+        }
+    }
+
+    return data;
+}
+
+// without allocating memory
+bool XmltvFetcher::parseTime(const QStringRef &time, qint64 &secsSinceEpoch)
+{
+    const QChar *it = time.unicode();
+    const QChar *end = it + time.size();
 
-    Database::instance().addGroup(id, name, "");
+    // year, month, day, hour, minute, second
+    const int widths[] = {4, 2, 2, 2, 2, 2};
+    int fields[] = {0, 1, 1, 0, 0, 0};
+    int fieldCount = 0;
+    while (fieldCount < 6 && it != end && it->isDigit()) {
+        if (!readDigits(it, end, widths[fieldCount], fields[fieldCount])) {
+            return false;
+        }
+        ++fieldCount;
+    }
+    if (fieldCount == 0 || fields[1] < 1 || fields[1] > 12 || fields[2] < 1 || fields[2] > 31 || fields[3] > 23 || fields[4] > 59 || fields[5] > 60) {
+        return false;
+    }
 
-    Q_EMIT groupUpdated(id);
+    // offset from UTC (e.g. "+0530"), time zone names are treated as UTC
+    while (it != end && *it == QLatin1Char(' ')) {
+        ++it;
+    }
+    int offset = 0;
+    if (it != end && (*it == QLatin1Char('+') || *it == QLatin1Char('-'))) {
+        const int sign = *it == QLatin1Char('-') ? -1 : 1;
+        ++it;
+        int hours = 0;
+        int minutes = 0;
+        if (!readDigits(it, end, 2, hours)) {
+            return false;
+        }
+        if (it != end && !readDigits(it, end, 2, minutes)) {
+            return false;
+        }
+        offset = sign * (hours * 3600 + minutes * 60);
+    }
+
+    secsSinceEpoch = daysFromCivil(fields[0], fields[1], fields[2]) * 86400 + fields[3] * 3600 + fields[4] * 60 + fields[5] - offset;
+    return true;
 }
 
-void XmltvFetcher::processProgram(const QDomNode &program)
+ProgramData XmltvFetcher::processProgram(QXmlStreamReader &xml) const
 {
     ProgramData data;
 
-    const QDomNamedNodeMap &attributes = program.attributes();
-    data.m_channelId = ChannelId(attributes.namedItem("channel").toAttr().value());
-    const QString &startTimeString = attributes.namedItem("start").toAttr().value();
-    QDateTime startTime = QDateTime::fromString(startTimeString.left(14), "yyyyMMddHHmmss");
-    const int startTimeOffset = startTimeString.right(5).leftRef(3).toInt();
-    startTime.setOffsetFromUtc(startTimeOffset * 3600);
-    startTime = startTime.toUTC();
-    data.m_startTime = startTime;
+    const QXmlStreamAttributes attributes = xml.attributes();
+    data.m_channelId = ChannelId(attributes.value(QLatin1String("channel")).toString());
+    data.m_startTime = parseDateTime(attributes.value(QLatin1String("start")));
     // channel + start time can be used as ID
-    data.m_id = ProgramId(data.m_channelId.value() + "_" + QString::number(startTime.toSecsSinceEpoch()));
-    const QString &stopTimeString = attributes.namedItem("stop").toAttr().value();
-    QDateTime stopTime = QDateTime::fromString(stopTimeString.left(14), "yyyyMMddHHmmss");
-    const int stopTimeOffset = stopTimeString.right(5).leftRef(3).toInt();
-    stopTime.setOffsetFromUtc(stopTimeOffset * 3600);
-    stopTime = stopTime.toUTC();
-    data.m_stopTime = stopTime;
-    data.m_title = program.namedItem("title").toElement().text();
-    data.m_subtitle = program.namedItem("sub-title").toElement().text();
-    data.m_description = program.namedItem("desc").toElement().text();
+    data.m_id = ProgramId(data.m_channelId.value() + "_" + QString::number(data.m_startTime.toSecsSinceEpoch()));
+    data.m_stopTime = parseDateTime(attributes.value(QLatin1String("stop")));
 
-    if (program.isElement()) {
-        QDomNodeList categoryNodes = program.toElement().elementsByTagName("category");
-        for (int i = 0; i < categoryNodes.count(); i++) {
-            data.m_categories.push_back(categoryNodes.at(i).toElement().text());
+    // use the first title, sub-title and description
+    bool hasTitle = false;
+    bool hasSubtitle = false;
+    bool hasDescription = false;
+    while (xml.readNextStartElement()) {
+        if (!hasTitle && xml.name() == QLatin1String("title")) {
+            data.m_title = xml.readElementText(QXmlStreamReader::IncludeChildElements);
+            hasTitle = true;
+        } else if (!hasSubtitle && xml.name() == QLatin1String("sub-title")) {
+            data.m_subtitle = xml.readElementText(QXmlStreamReader::IncludeChildElements);
+            hasSubtitle = true;
+        } else if (!hasDescription && xml.name() == QLatin1String("desc")) {
+            data.m_description = xml.readElementText(QXmlStreamReader::IncludeChildElements);
+            hasDescription = true;
+        } else if (xml.name() == QLatin1String("category")) {
+            // resolved to IDs after the import (the chunks are parsed concurrently)
+            data.m_categoryNames.push_back(xml.readElementText(QXmlStreamReader::IncludeChildElements));
+        } else {
+            xml.skipCurrentElement();
         }
     }
 
+    std::sort(data.m_categoryNames.begin(), data.m_categoryNames.end());
+    data.m_categoryNames.erase(std::unique(data.m_categoryNames.begin(), data.m_categoryNames.end()), data.m_categoryNames.end());
+
     data.m_descriptionFetched = true;
 
-    Database::instance().addProgram(data);
+    return data;
+}
+
+bool XmltvFetcher::readPrograms(QXmlStreamReader &xml, const QVector<QString> &channelIds, QVector<ProgramData> &programs, int batchSize) const
+{
+    while (xml.readNextStartElement()) {
+        // check the channel before parsing the complete program
+        if (xml.name() == QLatin1String("programme")
+            && std::binary_search(channelIds.begin(), channelIds.end(), xml.attributes().value(QLatin1String("channel")), ChannelIdLess())) {
+            const ProgramData program = processProgram(xml);
+            if (program.m_startTime.isValid()) {
+                programs.push_back(program);
+            }
+            if (programs.size() >= batchSize) {
+                return true;
+            }
+        } else {
+            xml.skipCurrentElement();
+        }
+    }
+    return false;
+}
+
+bool XmltvFetcher::importSources(XmltvSources &sources,
+                                 const QVector<ChannelId> &channelIds,
+                                 int threadCount,
+                                 int batchSize,
+                                 const ProgramSink &store) const
+{
+    if (sources.size() == 1) {
+        return importPrograms(sources.front()->file(), sources.front()->data(), channelIds, threadCount, batchSize, store);
+    }
+
+    // stream the sources in priority order (all threads per source), only the accepted time intervals are kept:
+    // a program is dropped if it overlaps a program of the same channel from an earlier source
+    bool success = true;
+    QHash<QString, QMap<qint64, qint64>> accepted; // per channel: start -> stop
+    QVector<ProgramData> merged;
+    merged.reserve(batchSize);
+    for (auto &source : sources) {
+        QHash<QString, QMap<qint64, qint64>> added;
+        const auto filter = [&accepted, &added, &merged, &store](const QVector<ProgramData> &programs) {
+            for (const auto &program : programs) {
+                const QString &channelId = program.m_channelId.value();
+                const qint64 start = program.m_startTime.toSecsSinceEpoch();
+                const qint64 stop = program.m_stopTime.isValid() ? qMax(start + 1, program.m_stopTime.toSecsSinceEpoch()) : start + 1;
+                if (overlaps(accepted.value(channelId), start, stop)) {
+                    continue;
+                }
+                added[channelId].insert(start, stop);
+
+                merged.push_back(program);
+            }
+            store(merged);
+            merged.clear();
+        };
+        success &= importPrograms(source->file(), source->data(), channelIds, threadCount, batchSize, filter);
+
+        // accepted after the source (programs of the same source may overlap each other)
+        for (auto it = added.cbegin(); it != added.cend(); ++it) {
+            QMap<qint64, qint64> &intervals = accepted[it.key()];
+            for (auto interval = it->cbegin(); interval != it->cend(); ++interval) {
+                intervals.insert(interval.key(), interval.value());
+            }
+        }
+    }
+
+    return success;
+}
+
+bool XmltvFetcher::importPrograms(QFile &file,
+                                  const QByteArray &data,
+                                  const QVector<ChannelId> &channelIds,
+                                  int threadCount,
+                                  int batchSize,
+                                  const ProgramSink &store) const
+{
+    // sorted to look up channels without allocating strings
+    QVector<QString> requestedChannels;
+    for (const auto &channelId : channelIds) {
+        requestedChannels.push_back(channelId.value());
+    }
+    std::sort(requestedChannels.begin(), requestedChannels.end());
+
+    if (!data.isEmpty()) {
+        // process the programs of all requested channels in a single pass (parallel if possible)
+        const QVector<int> chunks = threadCount > 1 ? splitPrograms(data, threadCount) : QVector<int>();
+        if (chunks.size() > 2) {
+            return importPrograms(data, chunks, requestedChannels, threadCount, store);
+        }
+        SegmentDevice device(QVector<QByteArray>{data});
+        return importPrograms(device, requestedChannels, batchSize, store);
+    }
+
+    const KCompressionDevice::CompressionType compression = compressionType(file);
+    if (compression != KCompressionDevice::None) {
+        // decompress on the fly (no temporary file) in a separate thread while parsing
+        KCompressionDevice decompressor(&file, false, compression);
+        if (!decompressor.open(QIODevice::ReadOnly)) {
+            qCritical() << "Failed to decompress" << file.fileName();
+            return false;
+        }
+        ReadAheadDevice device(&decompressor);
+        return importPrograms(device, requestedChannels, batchSize, store);
+    }
+
+    return importPrograms(file, requestedChannels, batchSize, store);
+}
+
+bool XmltvFetcher::importPrograms(QIODevice &device, const QVector<QString> &channelIds, int batchSize, const ProgramSink &store) const
+{
+    QVector<ProgramData> programs;
+    programs.reserve(batchSize);
+
+    QXmlStreamReader xml(&device);
+    if (xml.readNextStartElement()) { // <tv>
+        while (readPrograms(xml, channelIds, programs, batchSize)) {
+            store(programs);
+            programs.clear();
+        }
+    }
+
+    store(programs);
+
+    if (xml.hasError()) {
+        qWarning() << "Failed to parse XMLTV programs:" << xml.errorString();
+        return false;
+    }
+    return true;
+}
+
+bool XmltvFetcher::importPrograms(const QByteArray &data,
+                                  const QVector<int> &chunks,
+                                  const QVector<QString> &channelIds,
+                                  int threadCount,
+                                  const ProgramSink &store) const
+{
+    const QByteArray prolog = xmlDeclaration(data);
+
+    QThreadPool pool;
+    pool.setMaxThreadCount(threadCount);
+
+    bool success = true;
+
+    // process the chunks in rounds of threadCount chunks to keep the memory usage bounded
+    const int chunkCount = chunks.size() - 1;
+    for (int first = 0; first < chunkCount; first += threadCount) {
+        const int count = qMin(threadCount, chunkCount - first);
+        std::vector<QVector<ProgramData>> results(count);
+        std::vector<char> successes(count, false);
+        for (int i = 0; i < count; ++i) {
+            const QByteArray chunk = QByteArray::fromRawData(data.constData() + chunks.at(first + i), chunks.at(first + i + 1) - chunks.at(first + i));
+            QVector<ProgramData> &result = results[i];
+            char &chunkSuccess = successes[i];
+            pool.start([this, &prolog, &channelIds, &result, &chunkSuccess, chunk]() {
+                chunkSuccess = processChunk(prolog, chunk, channelIds, result);
+            });
+        }
+        pool.waitForDone();
+
+        // merge in file order such that the result is identical to the serial import
+        for (int i = 0; i < count; ++i) {
+            store(results[i]);
+            success &= successes[i] != 0;
+        }
+    }
+
+    return success;
+}
+
+bool XmltvFetcher::processChunk(const QByteArray &prolog, const QByteArray &chunk, const QVector<QString> &channelIds, QVector<ProgramData> &programs) const
+{
+    // a chunk contains complete top-level elements only, wrap them to get a well-formed document
+    SegmentDevice device(QVector<QByteArray>{prolog + "<tv>", chunk, QByteArrayLiteral("</tv>")});
+
+    QXmlStreamReader xml(&device);
+    if (xml.readNextStartElement()) { // <tv>
+        readPrograms(xml, channelIds, programs, std::numeric_limits<int>::max());
+    }
+
+    if (xml.hasError()) {
+        qWarning() << "Failed to parse XMLTV chunk:" << xml.errorString();
+        return false;
+    }
+    return true;
 }
@@ -5,7 +5,75 @@
 
 #include "fetcherimpl.h"
 
-#include <QtXml>
+#include "channeldata.h"
+#include "programdata.h"
+
+#include <QFileSystemWatcher>
+#include <QHash>
+#include <QSemaphore>
+#include <QSet>
+#include <QStringList>
+#include <QThreadPool>
+#include <QTimer>
+#include <QVector>
+
+#include <functional>
+#include <limits>
+#include <memory>
+#include <vector>
+
+class Database;
+class QFile;
+class QIODevice;
+class QXmlStreamReader;
+
+class XmltvSource; // opened XMLTV file
+using XmltvSources = std::vector<std::unique_ptr<XmltvSource>>;
+
+// changes of imported programs compared to the programs in the database
+// used by the database writer batch by batch: only the stored programs of the channels and times of a batch are read
+class ProgramDiff
+{
+public:
+    QVector<ProgramData> changed(const Database &database, const QVector<ProgramData> &programs); // new or modified programs
+    QVector<ProgramId> removed(const Database &database, const QVector<ChannelId> &channelIds); // call after all programs have been passed to changed()
+    bool hasChanged(const ChannelId &channelId) const;
+    int changedCount() const;
+    int removedCount() const;
+
+private:
+    QSet<QString> m_imported; // IDs
+    QHash<QString, qint64> m_firstStart; // per channel
+    qint64 m_first = std::numeric_limits<qint64>::max();
+    QSet<QString> m_changedChannels;
+    int m_changedCount = 0;
+    int m_removedCount = 0;
+};
+
+// import of the XMLTV file in a worker thread
+struct BackgroundImport {
+    explicit BackgroundImport(const QVector<ChannelId> &ids)
+        : channelIds(ids)
+    {
+    }
+
+    // input (taken from the settings and the database before the parsing starts)
+    QStringList fileNames;
+    QVector<ChannelId> channelIds;
+    QHash<QString, QString> storedFingerprints;
+    int threadCount = 1;
+    int batchSize = 1;
+    bool reportErrors = false; // requested by the user (not a file change)
+
+    // the database writer stores a batch while the next one is parsed
+    QSemaphore writable{1};
+    ProgramDiff diff; // only used by the database writer
+
+    // result
+    Error error;
+    QString fingerprint;
+    bool success = false;
+};
 
 class XmltvFetcher : public FetcherImpl
 {
@@ -17,13 +85,53 @@ public:
     void fetchGroups() override;
     void fetchGroup(const QString &url, const GroupId &groupId) override;
     void fetchProgram(const ChannelId &channelId) override;
-    void fetchProgramDescription(const ChannelId &channelId, const ProgramId &programId, const QString &url) override;
+    void fetchPrograms(const QVector<ChannelId> &channelIds, FetchPriority priority) override;
+    void fetchProgramDescription(const ChannelId &channelId, const ProgramId &programId, const QString &url, FetchPriority priority) override;
+    void settingsChanged() override; // re-imports if other files have been selected
+
+    // "YYYYMMDDhhmmss +HHMM" where the time can be truncated (e.g. "YYYYMMDDhhmm") and the offset is optional (UTC if missing)
+    static bool parseTime(const QStringRef &time, qint64 &secsSinceEpoch);
 
 private:
-    bool open(const QString &fileName);
-    void fetchChannel(const ChannelId &channelId, const QString &name, const GroupId &groupId, const QString &icon);
-    void processGroup(const QDomElement &group);
-    void processProgram(const QDomNode &program);
+    // receives batches of new/modified programs
+    using ProgramSink = std::function<void(const QVector<ProgramData> &)>;
+
+    bool openSources(const QStringList &fileNames, XmltvSources &sources, QString &sourcesFingerprint, Error &error) const;
+    void importRequestedChannels();
+    void watch();
+    void fileChanged();
+    void importInBackground();
+    void startImport(const QVector<ChannelId> &channelIds, bool reportErrors);
+    void parseInBackground(const std::shared_ptr<BackgroundImport> &import);
+    void applyImport(const std::shared_ptr<BackgroundImport> &import);
+    void importFinished();
+    void fetchChannels(QFile &file, const GroupId &groupId, int batchSize); // in the import thread
+    void errorInGroup(const GroupId &groupId, const Error &error); // emits errorFetchingGroup in the GUI thread
+    void addChannels(const QVector<ChannelData> &channels, const GroupId &groupId);
+    ChannelData processChannel(QXmlStreamReader &xml) const;
+    ProgramData processProgram(QXmlStreamReader &xml) const;
+    bool readPrograms(QXmlStreamReader &xml, const QVector<QString> &channelIds, QVector<ProgramData> &programs, int batchSize) const;
+    bool importSources(XmltvSources &sources, const QVector<ChannelId> &channelIds, int threadCount, int batchSize, const ProgramSink &store) const;
+    bool importPrograms(QFile &file,
+                        const QByteArray &data,
+                        const QVector<ChannelId> &channelIds,
+                        int threadCount,
+                        int batchSize,
+                        const ProgramSink &store) const;
+    bool importPrograms(QIODevice &device, const QVector<QString> &channelIds, int batchSize, const ProgramSink &store) const;
+    bool importPrograms(const QByteArray &data,
+                        const QVector<int> &chunks,
+                        const QVector<QString> &channelIds,
+                        int threadCount,
+                        const ProgramSink &store) const;
+    bool processChunk(const QByteArray &prolog, const QByteArray &chunk, const QVector<QString> &channelIds, QVector<ProgramData> &programs) const;
 
-    QDomDocument m_doc;
+    QFileSystemWatcher m_watcher;
+    QTimer m_importTimer;
+    QStringList m_fileNames; // watched
+    QString m_fileState;
+    QVector<ChannelId> m_requestedChannels;
+    bool m_importRunning = false;
+    bool m_importPending = false;
+    QThreadPool m_importPool; // last member: waits for a running import before the other members are destroyed
 };